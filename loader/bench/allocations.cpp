@@ -0,0 +1,28 @@
+#include <cstdlib>
+#include <new>
+
+// Counts heap allocations per thread, so geode-bench can check that
+// logging doesn't allocate on the thread that logs. Kept in its own
+// file so the replaced operators aren't inlined into their callers
+
+static thread_local size_t t_allocations = 0;
+
+size_t getThreadAllocations() {
+    return t_allocations;
+}
+
+void* operator new(size_t size) {
+    t_allocations++;
+    if (auto ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
@@ -0,0 +1,662 @@
+#include <DependencyGraph.hpp>
+#include <EventRegistry.hpp>
+#include <FileWriter.hpp>
+#include <LogSink.hpp>
+#include <ModInfoCache.hpp>
+#include <ZipDirectory.hpp>
+#include <Geode/utils/json.hpp>
+#include <../platform/IncludeZlib.h>
+#include <fs/filesystem.hpp>
+#include <fmt/format.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = ghc::filesystem;
+
+/**
+ * Heap allocations made by the calling thread so far. Defined with
+ * the replaced operator new in allocations.cpp
+ */
+size_t getThreadAllocations();
+
+static void printUsage() {
+    std::cout <<
+        "Usage: geode-bench [options]\n"
+        "Generates synthetic .geode mods and times what the loader does with them\n"
+        "Options:\n"
+        "  --mods <n,n,...>    Numbers of mods to run with (default 10,100,200,1000)\n"
+        "  --runs <n>          Times to repeat each phase (default 5)\n"
+        "  --dir <path>        Where to generate mods (default: system temp dir)\n"
+        "  --events <n>        Events to post in the event phases (default 1000000)\n"
+        "  --handlers <n>      Event handlers to listen with (default 1000)\n"
+        "  --lines <n>         Lines to log in the log phases (default 100000)\n"
+        "  --json              Print one JSON object per result\n";
+}
+
+struct ZipFileData {
+    std::string m_name;
+    std::string m_data;
+    bool m_compress;
+};
+
+struct DiscoveredMod {
+    fs::path m_path;
+    std::string m_id;
+    std::vector<std::pair<std::string, bool>> m_dependencies;
+};
+
+static void putLE(std::string& out, uint32_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out += static_cast<char>((value >> (i * 8)) & 0xff);
+    }
+}
+
+static std::string deflateRaw(std::string const& data) {
+    z_stream stream {};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+static std::string makeZip(std::vector<ZipFileData> const& files) {
+    std::string out;
+    std::string directory;
+    for (auto& file : files) {
+        auto crc = static_cast<uint32_t>(crc32(
+            0, reinterpret_cast<Bytef const*>(file.m_data.data()),
+            static_cast<uInt>(file.m_data.size())
+        ));
+        auto data = file.m_compress ? deflateRaw(file.m_data) : file.m_data;
+        auto method = file.m_compress ? ZipDirectory::METHOD_DEFLATED : ZipDirectory::METHOD_STORED;
+        auto offset = static_cast<uint32_t>(out.size());
+
+        auto putCommon = [&](std::string& to) {
+            putLE(to, 0, 2);
+            putLE(to, method, 2);
+            putLE(to, 0, 4);
+            putLE(to, crc, 4);
+            putLE(to, static_cast<uint32_t>(data.size()), 4);
+            putLE(to, static_cast<uint32_t>(file.m_data.size()), 4);
+            putLE(to, static_cast<uint32_t>(file.m_name.size()), 2);
+            putLE(to, 0, 2);
+        };
+
+        putLE(out, 0x04034b50, 4);
+        putLE(out, 20, 2);
+        putCommon(out);
+        out += file.m_name;
+        out += data;
+
+        putLE(directory, 0x02014b50, 4);
+        putLE(directory, 20, 2);
+        putLE(directory, 20, 2);
+        putCommon(directory);
+        putLE(directory, 0, 2);
+        putLE(directory, 0, 2);
+        putLE(directory, 0, 2);
+        putLE(directory, 0, 4);
+        putLE(directory, offset, 4);
+        directory += file.m_name;
+    }
+    auto directoryOffset = static_cast<uint32_t>(out.size());
+    out += directory;
+    putLE(out, 0x06054b50, 4);
+    putLE(out, 0, 2);
+    putLE(out, 0, 2);
+    putLE(out, static_cast<uint32_t>(files.size()), 2);
+    putLE(out, static_cast<uint32_t>(files.size()), 2);
+    putLE(out, static_cast<uint32_t>(directory.size()), 4);
+    putLE(out, directoryOffset, 4);
+    putLE(out, 0, 2);
+    return out;
+}
+
+static std::string readFile(fs::path const& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream buf;
+    buf << file.rdbuf();
+    return buf.str();
+}
+
+static void writeFile(fs::path const& path, std::string const& data) {
+    std::ofstream file(path, std::ios::binary);
+    file.write(data.data(), data.size());
+}
+
+static std::string modID(size_t i) {
+    return fmt::format("geode-bench.mod-{:05}", i);
+}
+
+/**
+ * Mods only depend on mods with lower numbers, so the graph is
+ * always acyclic but can get as deep as the number of mods
+ */
+static void generateMods(fs::path const& dir, size_t count) {
+    std::mt19937 rng(1);
+    std::string noise(16 * 1024, '\0');
+    for (auto& c : noise) {
+        c = static_cast<char>(rng());
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        auto id = modID(i);
+        nlohmann::json json = {
+            { "geode", "v0.6.1" },
+            { "id", id },
+            { "name", fmt::format("Bench Mod {}", i) },
+            { "version", "v1.0.0" },
+            { "developer", "geode-bench" },
+            { "description", "Synthetic mod generated for benchmarking" },
+            { "dependencies", nlohmann::json::array() },
+            { "settings", nlohmann::json::object() },
+        };
+        auto depCount = i ? std::min<size_t>(rng() % 4, i) : 0;
+        for (size_t d = 0; d < depCount; d++) {
+            json["dependencies"].push_back({
+                { "id", modID(rng() % i) },
+                { "version", "v1.0.0" },
+                { "required", rng() % 4 != 0 },
+            });
+        }
+        for (size_t s = 0; s < 10; s++) {
+            json["settings"][fmt::format("setting-{}", s)] = {
+                { "type", "int" },
+                { "default", static_cast<int>(s) },
+                { "name", fmt::format("Setting {}", s) },
+            };
+        }
+
+        auto resources = "resources/" + id + "/";
+        // pngs are already compressed, so they're stored as-is
+        writeFile(dir / (id + ".geode"), makeZip({
+            { "mod.json", json.dump(4), true },
+            { "about.md", fmt::format("# {}\n\nDoes nothing at all.\n", id), true },
+            { resources + "sheet.plist", std::string(2048, 'p'), true },
+            { resources + "icon.png", noise.substr(0, 4096), false },
+            { resources + "sheet.png", noise, false },
+        }));
+    }
+}
+
+// The mod phases call the loader's own ModInfoCache, ZipDirectory,
+// DependencyGraph and FileWriter. What needs the game is left out:
+// mod.json is only read for IDs and dependencies instead of going
+// through ModInfo, indexing stands in for ArchiveFS::mount, and the
+// settings are plain JSON instead of Mod's settings
+
+static std::optional<std::string> readZipEntry(
+    std::string const& data, std::vector<ZipDirectory::Entry> const& entries,
+    std::string_view name
+) {
+    auto bytes = reinterpret_cast<unsigned char const*>(data.data());
+    auto entry = std::find_if(entries.begin(), entries.end(), [&](auto const& entry) {
+        return entry.m_name == name;
+    });
+    if (entry == entries.end() || !entry->isSupported()) {
+        return std::nullopt;
+    }
+    auto offset = ZipDirectory::getDataOffset(bytes, data.size(), *entry);
+    std::string text(entry->m_size, '\0');
+    if (!offset || !ZipDirectory::extract(
+        bytes + *offset, entry->m_method, entry->m_compressedSize, entry->m_size,
+        reinterpret_cast<unsigned char*>(text.data())
+    )) {
+        return std::nullopt;
+    }
+    return text;
+}
+
+/**
+ * Find mods like Loader::refreshMods does: archives that are in the
+ * mod info cache aren't opened, the rest have their mod.json and
+ * about.md read and are added to it
+ */
+static std::vector<DiscoveredMod> discoverMods(fs::path const& dir, fs::path const& cacheFile) {
+    auto& cache = ModInfoCache::get();
+    cache.load(cacheFile, "bench");
+
+    std::vector<DiscoveredMod> mods;
+    for (auto& entry : fs::directory_iterator(dir)) {
+        if (entry.path().extension() != ".geode") continue;
+
+        nlohmann::ordered_json json;
+        if (auto cached = cache.find(entry.path())) {
+            json = std::move(cached->m_json);
+        } else {
+            auto data = readFile(entry.path());
+            std::vector<ZipDirectory::Entry> entries;
+            if (auto err = ZipDirectory::read(
+                reinterpret_cast<unsigned char const*>(data.data()), data.size(), entries
+            )) {
+                throw std::runtime_error(entry.path().string() + ": " + *err);
+            }
+            auto modJson = readZipEntry(data, entries, "mod.json");
+            if (!modJson) {
+                throw std::runtime_error(entry.path().string() + " has no readable mod.json");
+            }
+            json = nlohmann::ordered_json::parse(*modJson);
+            std::vector<std::pair<std::string, std::string>> files;
+            if (auto about = readZipEntry(data, entries, "about.md")) {
+                files.push_back({ "about.md", *about });
+            }
+            cache.store(entry.path(), json, files);
+        }
+
+        auto& mod = mods.emplace_back();
+        mod.m_path = entry.path();
+        mod.m_id = json["id"];
+        for (auto& dep : json["dependencies"]) {
+            mod.m_dependencies.push_back({ dep["id"], dep.value("required", true) });
+        }
+    }
+    if (auto err = cache.save(cacheFile)) {
+        throw std::runtime_error(*err);
+    }
+    return mods;
+}
+
+/**
+ * Index every mod's resources like ArchiveFS::mount does, but from
+ * a copy of the archive instead of a mapping
+ */
+static size_t indexResources(std::vector<DiscoveredMod> const& mods) {
+    std::unordered_map<std::string, size_t> index;
+    for (auto& mod : mods) {
+        auto data = readFile(mod.m_path);
+        auto bytes = reinterpret_cast<unsigned char const*>(data.data());
+        std::vector<ZipDirectory::Entry> entries;
+        if (auto err = ZipDirectory::read(bytes, data.size(), entries)) {
+            throw std::runtime_error(mod.m_path.string() + ": " + *err);
+        }
+        for (auto& entry : entries) {
+            if (!entry.m_name.starts_with("resources/")) continue;
+            if (auto offset = ZipDirectory::getDataOffset(bytes, data.size(), entry)) {
+                index.insert({ entry.m_name.substr(10), *offset });
+            }
+        }
+    }
+    return index.size();
+}
+
+static size_t resolveMods(std::vector<DiscoveredMod> mods) {
+    std::sort(mods.begin(), mods.end(), [](auto const& a, auto const& b) {
+        return a.m_id < b.m_id;
+    });
+    std::vector<DependencyGraph::Node> nodes(mods.size());
+    for (size_t i = 0; i < mods.size(); i++) {
+        nodes[i].m_id = mods[i].m_id;
+        for (auto& [id, required] : mods[i].m_dependencies) {
+            nodes[i].m_dependencies.push_back({ id, required });
+        }
+    }
+    std::vector<size_t> cyclic;
+    auto layers = DependencyGraph::sortIntoLayers(nodes, cyclic);
+    if (cyclic.size()) {
+        throw std::runtime_error("generated mods have a dependency cycle");
+    }
+    return layers.size();
+}
+
+/**
+ * Files shaped like the ones Loader::saveSettings and
+ * Mod::saveSettings write, queued through FileWriter. Only
+ * the first `changed` mods are serialized, like only mods with
+ * changes are in the loader; `generation` makes their files differ
+ * from the last save so the writer doesn't skip them
+ */
+static void saveSettings(
+    fs::path const& dir, std::vector<DiscoveredMod> const& mods,
+    size_t changed, size_t generation
+) {
+    auto json = nlohmann::json::object();
+    json["mods"] = nlohmann::json::object();
+    for (size_t i = 0; i < mods.size(); i++) {
+        auto& mod = mods[i];
+        json["mods"][mod.m_id] = { { "enabled", true } };
+        if (i >= changed) continue;
+
+        auto modDir = dir / mod.m_id;
+        fs::create_directories(modDir);
+        auto settings = nlohmann::json::object();
+        for (size_t s = 0; s < 10; s++) {
+            settings[fmt::format("setting-{}", s)] = s * 2 + generation;
+        }
+        FileWriter::get().write(modDir / "settings.json", settings.dump());
+        nlohmann::json ds = {
+            { "times-opened", generation },
+            { "last-level", "Bloodbath" },
+            { "history", std::vector<int>(50, 7) },
+        };
+        FileWriter::get().write(modDir / "ds.json", ds.dump());
+    }
+    FileWriter::get().write(dir / "mods.json", json.dump());
+    // what the loader does when the game closes
+    if (auto error = FileWriter::get().flush()) {
+        throw std::runtime_error(error.value());
+    }
+}
+
+static void loadSettings(fs::path const& dir, std::vector<DiscoveredMod> const& mods) {
+    auto json = nlohmann::json::parse(readFile(dir / "mods.json"));
+    for (auto& mod : mods) {
+        if (!json["mods"].contains(mod.m_id)) {
+            throw std::runtime_error("mods.json is missing " + mod.m_id);
+        }
+        auto modDir = dir / mod.m_id;
+        auto settings = nlohmann::json::parse(readFile(modDir / "settings.json"));
+        auto ds = nlohmann::json::parse(readFile(modDir / "ds.json"));
+        if (!settings.is_object() || !ds.is_object()) {
+            throw std::runtime_error("settings for " + mod.m_id + " didn't load");
+        }
+    }
+}
+
+struct Timing {
+    double m_best;
+    double m_median;
+};
+
+/**
+ * @param after Run after each timed run, without being timed
+ */
+static Timing time(size_t runs, std::function<void()> func, std::function<void()> after = {}) {
+    std::vector<double> times;
+    for (size_t i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        times.push_back(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start
+        ).count());
+        if (after) after();
+    }
+    std::sort(times.begin(), times.end());
+    return { times.front(), times[times.size() / 2] };
+}
+
+// Stand-ins for Event and BasicEventHandler; dispatch goes through
+// the same EventRegistry the loader uses
+struct BenchEvent {
+    virtual ~BenchEvent() = default;
+};
+
+template <size_t N>
+struct BenchTypedEvent : BenchEvent {};
+
+struct BenchHandler {
+    int m_priority;
+    size_t* m_calls;
+
+    int getPriority() const {
+        return m_priority;
+    }
+};
+
+using BenchRegistry = EventRegistry<BenchHandler, BenchEvent>;
+
+static constexpr size_t EVENT_TYPE_COUNT = 100;
+
+template <size_t... N>
+static void makeEventTypes(
+    BenchRegistry& registry,
+    std::vector<BenchRegistry::Bucket*>& buckets,
+    std::vector<std::unique_ptr<BenchEvent>>& events,
+    std::index_sequence<N...>
+) {
+    ((
+        buckets.push_back(registry.getOrCreateBucket(
+            typeid(BenchTypedEvent<N>),
+            +[](BenchEvent* ev) { return dynamic_cast<BenchTypedEvent<N>*>(ev) != nullptr; }
+        )),
+        events.push_back(std::make_unique<BenchTypedEvent<N>>())
+    ), ...);
+}
+
+/**
+ * Post events of 100 different types round-robin to handlers spread
+ * evenly across them. With baseHandlers, that many handlers also
+ * listen to the base class, so every post merges two buckets
+ */
+static Timing postEvents(size_t eventCount, size_t handlerCount, size_t baseHandlers, size_t runs) {
+    BenchRegistry registry;
+    std::vector<BenchRegistry::Bucket*> buckets;
+    std::vector<std::unique_ptr<BenchEvent>> events;
+    makeEventTypes(registry, buckets, events, std::make_index_sequence<EVENT_TYPE_COUNT>());
+
+    size_t calls = 0;
+    std::vector<BenchHandler> handlers(handlerCount + baseHandlers);
+    for (size_t i = 0; i < handlers.size(); i++) {
+        handlers[i] = { static_cast<int>(i % 7), &calls };
+    }
+    for (size_t i = 0; i < handlerCount; i++) {
+        registry.add(buckets[i % buckets.size()], &handlers[i]);
+    }
+    if (baseHandlers) {
+        auto base = registry.getOrCreateBucket(typeid(BenchEvent), +[](BenchEvent*) { return true; });
+        for (size_t i = handlerCount; i < handlers.size(); i++) {
+            registry.add(base, &handlers[i]);
+        }
+    }
+
+    return time(runs, [&] {
+        for (size_t i = 0; i < eventCount; i++) {
+            registry.dispatch(events[i % events.size()].get(), [](BenchHandler* handler) {
+                *handler->m_calls += 1;
+                return false;
+            });
+        }
+    });
+}
+
+static void logLines(LogSink& sink, size_t count) {
+    static std::string const thread = "main";
+    static auto sender = sink.getSender("geode.bench", "Bench");
+    for (size_t i = 0; i < count; i++) {
+        // what log::info("Frame {} took {} ms on {}", ...) captures
+        geode::log::LogRecord record;
+        record.m_time = geode::log::log_clock::now();
+        record.m_sender = sender;
+        record.m_severity = 1;
+        record.m_format = "Frame {} took {} ms on {}";
+        record.putUInt(i);
+        record.putFloat(16.6);
+        record.putString(thread);
+        sink.push(std::move(record));
+    }
+}
+
+/**
+ * Heap allocations the logging thread makes per line, with eight
+ * arguments and the writer keeping up
+ */
+static double logAllocations(LogSink& sink, size_t count) {
+    static std::string const path = "resources/sprites/icon.png";
+    static std::string const mod = "geode.bench";
+    static auto sender = sink.getSender(mod, "Bench");
+    sink.flush();
+    auto before = getThreadAllocations();
+    for (size_t i = 0; i < count; i++) {
+        geode::log::LogRecord record;
+        record.m_time = geode::log::log_clock::now();
+        record.m_sender = sender;
+        record.m_severity = 1;
+        record.m_format = "Loaded {} ({} of {}, {} bytes, {}x{}) for {} in {} ms";
+        record.putString(path);
+        record.putUInt(i);
+        record.putUInt(count);
+        record.putUInt(4096);
+        record.putInt(64);
+        record.putInt(64);
+        record.putString(mod);
+        record.putFloat(0.25);
+        sink.push(std::move(record));
+    }
+    auto allocations = getThreadAllocations() - before;
+    sink.flush();
+    return static_cast<double>(allocations) / count;
+}
+
+/**
+ * Log lines through the loader's log writer. "push" is what the
+ * logging thread pays while the writer thread keeps up in the
+ * background; "write" also waits for every line to be written
+ * @returns Allocations per line on the logging thread
+ */
+static double benchLogs(
+    fs::path const& dir, size_t lines, size_t runs,
+    std::function<void(std::string_view, Timing)> report
+) {
+    auto& sink = LogSink::get();
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    double allocations = 0;
+    for (auto binary : { false, true }) {
+        sink.start(dir / (binary ? "Geode bench.glog" : "Geode bench.log"), binary, {});
+        auto suffix = binary ? "-binary" : "";
+        report(fmt::format("push{}", suffix), time(runs, [&] {
+            logLines(sink, lines);
+        }, [&] {
+            sink.flush();
+        }));
+        report(fmt::format("write{}", suffix), time(runs, [&] {
+            logLines(sink, lines);
+            sink.flush();
+        }));
+        // fewer than fit in the buffer, so the logging thread
+        // never has to write anything out itself
+        allocations = std::max(allocations, logAllocations(sink, 1000));
+        sink.stop();
+    }
+    fs::remove_all(dir);
+    return allocations;
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> counts = { 10, 100, 200, 1000 };
+    size_t runs = 5;
+    auto root = fs::temp_directory_path() / "geode-bench";
+    bool json = false;
+    size_t eventCount = 1000000;
+    size_t handlerCount = 1000;
+    size_t lineCount = 100000;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--mods" && i + 1 < argc) {
+            counts.clear();
+            std::stringstream list(argv[++i]);
+            std::string count;
+            while (std::getline(list, count, ',')) {
+                counts.push_back(std::stoul(count));
+            }
+        } else if (arg == "--runs" && i + 1 < argc) {
+            runs = std::max<size_t>(std::stoul(argv[++i]), 1);
+        } else if (arg == "--dir" && i + 1 < argc) {
+            root = argv[++i];
+        } else if (arg == "--events" && i + 1 < argc) {
+            eventCount = std::stoul(argv[++i]);
+        } else if (arg == "--handlers" && i + 1 < argc) {
+            handlerCount = std::max<size_t>(std::stoul(argv[++i]), 1);
+        } else if (arg == "--lines" && i + 1 < argc) {
+            lineCount = std::stoul(argv[++i]);
+        } else if (arg == "--json") {
+            json = true;
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    auto report = [&](size_t count, std::string_view unit, std::string_view phase, Timing timing) {
+        if (json) {
+            std::cout << fmt::format(
+                "{{\"{}\":{},\"phase\":\"{}\",\"best_ms\":{:.3f},\"median_ms\":{:.3f}}}\n",
+                unit, count, phase, timing.m_best, timing.m_median
+            );
+        } else {
+            std::cout << fmt::format(
+                "{:>8} {:<8} {:<14} {:>10.2f} ms best {:>10.2f} ms median\n",
+                count, unit, phase, timing.m_best, timing.m_median
+            );
+        }
+    };
+
+    try {
+        report(eventCount, "events", "post", postEvents(eventCount, handlerCount, 0, runs));
+        report(eventCount, "events", "post-merged", postEvents(
+            eventCount, handlerCount, std::max<size_t>(handlerCount / 100, 1), runs
+        ));
+        auto allocations = benchLogs(root / "logs", lineCount, runs, [&](std::string_view phase, Timing timing) {
+            report(lineCount, "lines", phase, timing);
+        });
+        if (json) {
+            std::cout << fmt::format("{{\"phase\":\"log-allocations\",\"per_line\":{}}}\n", allocations);
+        } else {
+            std::cout << fmt::format("{:>8} allocations per line logged\n", allocations);
+        }
+        if (allocations > 0) {
+            throw std::runtime_error("logging allocated on the logging thread");
+        }
+
+        for (auto count : counts) {
+            auto dir = root / std::to_string(count);
+            auto modsDir = dir / "mods";
+            auto saveDir = dir / "save";
+            fs::remove_all(dir);
+            fs::create_directories(modsDir);
+
+            report(count, "mods", "generate", time(1, [&] { generateMods(modsDir, count); }));
+
+            // cold is the first launch with these mods, or the first
+            // after they all changed; warm is every launch after
+            auto cacheFile = dir / "mod-info-cache.json";
+            std::vector<DiscoveredMod> mods;
+            report(count, "mods", "discover-cold", time(runs, [&] {
+                mods = discoverMods(modsDir, cacheFile);
+            }, [&] {
+                fs::remove(cacheFile);
+            }));
+            discoverMods(modsDir, cacheFile);
+            report(count, "mods", "discover-warm", time(runs, [&] {
+                mods = discoverMods(modsDir, cacheFile);
+            }));
+            if (mods.size() != count) {
+                throw std::runtime_error("didn't find all generated mods");
+            }
+            report(count, "mods", "index", time(runs, [&] { indexResources(mods); }));
+            report(count, "mods", "resolve", time(runs, [&] { resolveMods(mods); }));
+            size_t generation = 0;
+            report(count, "mods", "save", time(runs, [&] {
+                saveSettings(saveDir, mods, mods.size(), generation++);
+            }));
+            report(count, "mods", "save-one", time(runs, [&] {
+                saveSettings(saveDir, mods, 1, generation++);
+            }));
+            report(count, "mods", "load", time(runs, [&] { loadSettings(saveDir, mods); }));
+
+            fs::remove_all(dir);
+        }
+    } catch (std::exception const& e) {
+        std::cerr << "Benchmark failed: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,357 @@
+#include <DependencyGraph.hpp>
+#include <FileWriter.hpp>
+#include <LogSink.hpp>
+#include <WorkerPool.hpp>
+#include <Geode/utils/TrackedJson.hpp>
+#include <fmt/format.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = ghc::filesystem;
+
+// Checks for the parts of the loader in geode-loader-core. Each test
+// returns normally on success; CHECK reports and counts failures
+
+static size_t s_failures = 0;
+
+#define CHECK(...)                                                          \
+    do {                                                                    \
+        if (!(__VA_ARGS__)) {                                               \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " #__VA_ARGS__ "\n"; \
+            s_failures++;                                                   \
+        }                                                                   \
+    } while (false)
+
+using Layers = std::vector<std::vector<size_t>>;
+
+/**
+ * Nodes with IDs "0", "1", ... so tests can refer to them by index
+ */
+struct Graph {
+    std::vector<std::string> m_ids;
+    std::vector<DependencyGraph::Node> m_nodes;
+
+    Graph(size_t count) : m_ids(count), m_nodes(count) {
+        for (size_t i = 0; i < count; i++) {
+            m_ids[i] = std::to_string(i);
+        }
+        for (size_t i = 0; i < count; i++) {
+            m_nodes[i].m_id = m_ids[i];
+        }
+    }
+
+    void depend(size_t node, size_t on, bool required = true) {
+        m_nodes[node].m_dependencies.push_back({ m_ids[on], required });
+    }
+
+    Layers sort(std::vector<size_t>& cyclic) const {
+        return DependencyGraph::sortIntoLayers(m_nodes, cyclic);
+    }
+
+    size_t layerOf(Layers const& layers, size_t node) const {
+        for (size_t l = 0; l < layers.size(); l++) {
+            if (std::find(layers[l].begin(), layers[l].end(), node) != layers[l].end()) {
+                return l;
+            }
+        }
+        return layers.size();
+    }
+
+    /**
+     * Every node is in at most one layer, nodes in a layer are in
+     * order and don't depend on each other at all, and required
+     * dependencies are in earlier layers
+     */
+    void checkLayers(Layers const& layers) const {
+        std::vector<size_t> seen(m_nodes.size(), 0);
+        for (auto const& layer : layers) {
+            CHECK(!layer.empty());
+            CHECK(std::is_sorted(layer.begin(), layer.end()));
+            for (auto node : layer) {
+                seen[node]++;
+            }
+        }
+        for (size_t i = 0; i < m_nodes.size(); i++) {
+            CHECK(seen[i] <= 1);
+            auto layer = this->layerOf(layers, i);
+            if (layer == layers.size()) continue;
+            for (auto const& [id, required] : m_nodes[i].m_dependencies) {
+                auto dep = std::stoul(std::string(id));
+                if (dep == i) continue;
+                auto depLayer = this->layerOf(layers, dep);
+                CHECK(depLayer != layer);
+                if (required) {
+                    CHECK(depLayer < layer);
+                }
+            }
+        }
+    }
+};
+
+static void testDeep() {
+    // every node requires the one before it
+    Graph graph(1000);
+    for (size_t i = 1; i < 1000; i++) {
+        graph.depend(i, i - 1);
+    }
+    std::vector<size_t> cyclic;
+    auto layers = graph.sort(cyclic);
+    CHECK(cyclic.empty());
+    CHECK(layers.size() == 1000);
+    for (size_t i = 0; i < layers.size(); i++) {
+        CHECK(layers[i] == std::vector<size_t> { i });
+    }
+    graph.checkLayers(layers);
+}
+
+static void testWide() {
+    // every node requires the first one, and every other node
+    // optionally depends on its neighbour
+    Graph graph(1000);
+    for (size_t i = 1; i < 1000; i++) {
+        graph.depend(i, 0);
+        if (i % 2 == 0) {
+            graph.depend(i, i - 1, false);
+        }
+    }
+    std::vector<size_t> cyclic;
+    auto layers = graph.sort(cyclic);
+    CHECK(cyclic.empty());
+    CHECK(layers.size() == 3);
+    CHECK(layers[0] == std::vector<size_t> { 0 });
+    CHECK(layers[1].size() == 500);
+    CHECK(layers[2].size() == 499);
+    graph.checkLayers(layers);
+}
+
+static void testCycle() {
+    // 0 and 1 require each other, 2 requires 0, 3 is on its own
+    // and 4 optionally depends on the cycle
+    Graph graph(5);
+    graph.depend(0, 1);
+    graph.depend(1, 0);
+    graph.depend(2, 0);
+    graph.depend(4, 1, false);
+    std::vector<size_t> cyclic;
+    auto layers = graph.sort(cyclic);
+    std::sort(cyclic.begin(), cyclic.end());
+    CHECK(cyclic == std::vector<size_t> { 0, 1, 2 });
+    CHECK(layers.size() == 2);
+    CHECK(layers[0] == std::vector<size_t> { 3 });
+    CHECK(layers[1] == std::vector<size_t> { 4 });
+    graph.checkLayers(layers);
+}
+
+static void testOptionalCycle() {
+    // 0 and 1 optionally depend on each other, 2 requires 0 and
+    // 3 requires 1; the cycle must not end up in one layer
+    Graph graph(4);
+    graph.depend(0, 1, false);
+    graph.depend(1, 0, false);
+    graph.depend(2, 0);
+    graph.depend(3, 1);
+    std::vector<size_t> cyclic;
+    auto layers = graph.sort(cyclic);
+    CHECK(cyclic.empty());
+    CHECK(graph.layerOf(layers, 0) != graph.layerOf(layers, 1));
+    graph.checkLayers(layers);
+
+    // a longer optional cycle with a required edge in it
+    Graph ring(6);
+    for (size_t i = 0; i < 6; i++) {
+        ring.depend(i, (i + 1) % 6, i != 3);
+    }
+    cyclic.clear();
+    layers = ring.sort(cyclic);
+    CHECK(cyclic.empty());
+    ring.checkLayers(layers);
+    for (size_t i = 0; i < 6; i++) {
+        CHECK(ring.layerOf(layers, i) < layers.size());
+    }
+}
+
+static std::string readFile(fs::path const& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream buf;
+    buf << file.rdbuf();
+    return buf.str();
+}
+
+static void testFileWriter() {
+    auto dir = fs::temp_directory_path() / "geode-loader-tests";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    auto path = dir / "settings.json";
+    auto& writer = FileWriter::get();
+
+    // only the last of quick writes is written
+    writer.write(path, "first");
+    writer.write(path, "second");
+    CHECK(!writer.flush());
+    CHECK(readFile(path) == "second");
+    CHECK(!fs::exists(dir / "settings.json.tmp"));
+
+    // same size, different bytes
+    writer.write(path, "sEcond");
+    CHECK(!writer.flush());
+    CHECK(readFile(path) == "sEcond");
+
+    // identical content isn't written again
+    fs::remove(path);
+    writer.write(path, "sEcond");
+    CHECK(!writer.flush());
+    CHECK(!fs::exists(path));
+
+    // errors are reported to whoever flushes
+    writer.write(dir / "missing" / "settings.json", "{}");
+    CHECK(writer.flush().has_value());
+
+    // and the data is kept to be tried again
+    fs::create_directories(dir / "missing");
+    CHECK(!writer.flush());
+    CHECK(readFile(dir / "missing" / "settings.json") == "{}");
+
+    fs::remove_all(dir);
+}
+
+static void testTrackedJson() {
+    // what DataStore hands out
+    nlohmann::json root = { { "times-opened", 3 }, { "history", { 1, 2, 3 } } };
+    size_t generation = 0;
+    geode::TrackedJson json(root, generation);
+
+    // reads don't count, and don't create anything
+    int opened = json["times-opened"];
+    CHECK(opened == 3);
+    CHECK(json["history"][1].get<int>() == 2);
+    CHECK(json["history"] == nlohmann::json { 1, 2, 3 });
+    CHECK(json["missing"].read().is_null());
+    CHECK(json["missing"]["deeper"].read().is_null());
+    CHECK(json.contains("history"));
+    CHECK(!json.contains("missing"));
+    CHECK(generation == 0);
+    CHECK(!root.contains("missing"));
+
+    // writes do
+    json["times-opened"] = opened + 1;
+    CHECK(generation == 1);
+    CHECK(root["times-opened"] == 4);
+    json["history"].write().push_back(4);
+    CHECK(generation == 2);
+    CHECK(root["history"].size() == 4);
+    json["new"]["nested"] = "value";
+    CHECK(generation == 3);
+    CHECK(root["new"]["nested"] == "value");
+
+    // assigning one to another copies the value
+    json["copy"] = json["times-opened"];
+    CHECK(generation == 4);
+    CHECK(root["copy"] == 4);
+    json["copy"] = 5;
+    CHECK(root["times-opened"] == 4);
+
+    // numeric keys stay object keys, even under missing parents
+    json["scores"]["42"] = 1;
+    CHECK(root["scores"] == nlohmann::json { { "42", 1 } });
+    CHECK(json["scores"]["42"].get<int>() == 1);
+    CHECK(json["scores"][42].read().is_null());
+    json["list"][2] = true;
+    CHECK(root["list"] == nlohmann::json { nullptr, nullptr, true });
+    CHECK(json["list"]["2"].read().is_null());
+}
+
+static void testLogSink() {
+    auto dir = fs::temp_directory_path() / "geode-loader-tests-logs";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    auto path = dir / "Geode test.glog";
+    auto& sink = LogSink::get();
+    sink.start(path, true, {});
+    // the writer thread opens the file
+    while (!fs::exists(path)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // senders are the same pointer for the same mod
+    auto first = sink.getSender("geode.first", "First");
+    CHECK(first == sink.getSender("geode.first", "First"));
+    auto other = sink.getSender("geode.other", "Other");
+    CHECK(first != other);
+
+    // a format string in a mod's binary, at an address the next
+    // mod loaded reuses once the first is unloaded
+    char format[] = "first {}";
+    auto log = [&](LogSink::LogSender const* sender) {
+        LogSink::LogRecord record;
+        record.m_sender = sender;
+        record.m_format = format;
+        record.putInt(1);
+        sink.push(std::move(record));
+    };
+    log(first);
+    sink.prepareUnload();
+    std::strcpy(format, "other {}");
+    log(other);
+    sink.stop();
+
+    auto contents = readFile(path);
+    CHECK(contents.find("first {}") != std::string::npos);
+    CHECK(contents.find("other {}") != std::string::npos);
+    CHECK(contents.find("geode.other") != std::string::npos);
+
+    fs::remove_all(dir);
+}
+
+static void testWorkerPool() {
+    auto& pool = WorkerPool::get();
+
+    // every index is visited once
+    std::vector<std::atomic<int>> visits(1000);
+    pool.forEach(visits.size(), [&](size_t i) {
+        visits[i]++;
+    });
+    CHECK(std::all_of(visits.begin(), visits.end(), [](auto& v) { return v == 1; }));
+
+    // later calls reuse the same threads
+    auto threads = pool.getThreadCount();
+    CHECK(threads < std::max(std::thread::hardware_concurrency(), 1u));
+    for (size_t run = 0; run < 20; run++) {
+        std::atomic<size_t> sum = 0;
+        pool.forEach(100, [&](size_t i) {
+            sum += i;
+        });
+        CHECK(sum == 4950);
+    }
+    CHECK(pool.getThreadCount() == threads);
+
+    pool.forEach(0, [](size_t) {
+        CHECK(false);
+    });
+}
+
+int main() {
+    std::vector<std::pair<char const*, std::function<void()>>> tests = {
+        { "dependency graph: deep", testDeep },
+        { "dependency graph: wide", testWide },
+        { "dependency graph: cycle", testCycle },
+        { "dependency graph: optional cycle", testOptionalCycle },
+        { "file writer", testFileWriter },
+        { "tracked json", testTrackedJson },
+        { "log sink", testLogSink },
+        { "worker pool", testWorkerPool },
+    };
+    for (auto& [name, test] : tests) {
+        auto before = s_failures;
+        test();
+        std::cout << fmt::format("{} {}\n", s_failures == before ? "ok    " : "FAILED", name);
+    }
+    return s_failures ? 1 : 0;
+}
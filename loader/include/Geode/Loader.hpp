@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Geode/DefaultInclude.hpp>
+#include "loader/Dispatch.hpp"
 #include "loader/Hook.hpp"
 #include "loader/Log.hpp"
 #include "loader/Mod.hpp"
@@ -25,6 +25,7 @@ THE SOFTWARE.
 #define __SUPPORT_ZIPUTILS_H__
 
 #include <string>
+#include <functional>
 #include "../../platform/CCPlatformDefine.h"
 #include "../../platform/CCPlatformConfig.h"
 #include "../../include/ccMacros.h"
@@ -260,6 +261,34 @@ namespace cocos2d
          * @since geode v1.0.0
          */
         std::vector<std::string> getAllFiles() const;
+
+        /**
+         * Custom function added for geode; returns the CRC-32 of 
+         * a file as stored in the zip, without reading the file.
+         * 
+         * @param fileName File name
+         * @return CRC-32 of the file, or 0 if it doesn't exist
+         * 
+         * @since geode v1.0.0
+         */
+        unsigned long getFileCRC(const std::string &fileName) const;
+
+        /**
+         * Custom function added for geode; reads a file in chunks 
+         * and passes each one to a callback, so the whole file 
+         * never has to be held in memory.
+         * 
+         * @param fileName File name
+         * @param callback Called with each chunk and its size; 
+         *                 return false to stop reading
+         * @return true if the whole file was read, false otherwise
+         * 
+         * @since geode v1.0.0
+         */
+        bool readFileChunks(
+            const std::string &fileName,
+            const std::function<bool(const unsigned char*, unsigned long)> &callback
+        );
     )
 
     private:
@@ -1,43 +1,246 @@
 #pragma once
 
 #include "Event.hpp"
+#include "Trace.hpp"
 #include <string>
 #include <tuple>
 #include <functional>
+#include <atomic>
+#include <optional>
+#include <type_traits>
+#include <typeinfo>
 
 namespace geode {
 	// Mod interoperability
 
+	namespace impl {
+		/**
+		 * A function provided for a selector. Never changed or
+		 * freed once published, so a handle can read all of it
+		 * through one atomic load and compare it by address
+		 */
+		struct DispatchTarget {
+			void* m_function;
+			std::type_info const* m_signature;
+			Mod* m_provider;
+		};
+
+		/**
+		 * A selector's registered function. Slots are never
+		 * freed, so pointers to them stay valid for the whole
+		 * session even after the providing mod unloads
+		 */
+		struct DispatchSlot {
+			std::string m_selector;
+			/**
+			 * Replaced every time the function is provided or
+			 * revoked so handles know to resolve again
+			 */
+			std::atomic<DispatchTarget const*> m_target = nullptr;
+		};
+
+		/**
+		 * Records a dispatched call when tracing is enabled
+		 */
+		struct DispatchTraceScope {
+			DispatchSlot* m_slot;
+			DispatchTarget const* m_target;
+			uint64_t m_start;
+
+			DispatchTraceScope(DispatchSlot* slot, DispatchTarget const* target)
+			  : m_slot(slot), m_target(target), m_start(trace::now()) {}
+			~DispatchTraceScope() {
+				trace::record({
+					.m_name = m_slot->m_selector.c_str(),
+					.m_category = "dispatch",
+					.m_start = m_start,
+					.m_duration = trace::now() - m_start,
+					.m_mod = m_target->m_provider,
+				});
+			}
+		};
+	}
+
+	/**
+	 * Registry of functions mods expose to each other by
+	 * selector. Selectors are interned into numeric IDs
+	 * once; after that lookups don't touch strings
+	 */
+	class GEODE_DLL Dispatcher {
+	public:
+		/**
+		 * Get the ID of a selector, registering it if needed
+		 */
+		static size_t getSelectorID(std::string const& selector);
+		/**
+		 * Get the slot for a selector ID. The pointer is valid
+		 * for the rest of the session
+		 */
+		static impl::DispatchSlot* getSlot(size_t id);
+		/**
+		 * Register the function behind a selector. Replaces
+		 * any function previously provided for it
+		 */
+		static void provide(
+			size_t id, Mod* provider,
+			void* function, std::type_info const& signature
+		);
+		/**
+		 * Remove the function behind a selector
+		 */
+		static void revoke(size_t id);
+		/**
+		 * Remove every function provided by a mod. Called by
+		 * the loader when the mod is unloaded
+		 */
+		static void revokeAll(Mod* provider);
+	};
+
+	/**
+	 * Expose a function to other mods under a selector
+	 * @param selector Name of the function, like
+	 * "com.developer.mod/do-something"
+	 * @param function The function to call
+	 */
+	template <class R, class... Args>
+	void provideDispatch(
+		std::string const& selector,
+		R(*function)(Args...),
+		Mod* provider = Mod::get()
+	) {
+		Dispatcher::provide(
+			Dispatcher::getSelectorID(selector), provider,
+			reinterpret_cast<void*>(function), typeid(R(Args...))
+		);
+	}
+
 	template <typename ...Args>
 	class DispatchEvent : public Event {
 		std::string m_selector;
+		size_t m_selectorID;
 		std::tuple<Args...> m_args;
 	public:
 		DispatchEvent(std::string const& name, Args... args)
-		: m_selector(name), m_args(std::make_tuple(args...)) {}
+		: m_selector(name),
+		  m_selectorID(Dispatcher::getSelectorID(name)),
+		  m_args(std::make_tuple(args...)) {}
 
-		std::string const& selector() {
+		std::string const& selector() const {
 			return m_selector;
 		}
+
+		size_t selectorID() const {
+			return m_selectorID;
+		}
+
+		std::tuple<Args...> const& args() const {
+			return m_args;
+		}
 	};
 
+	/**
+	 * Event-based dispatch handler. Slower than providing
+	 * a function through provideDispatch, but can capture
+	 * state and lets multiple mods react to one selector
+	 */
 	template <typename ...Args>
 	class DispatchHandler : public EventHandler<DispatchEvent<Args...>> {
-		std::string m_selector;
+		size_t m_selectorID;
 		std::function<void(Args...)> m_callback;
 
 		DispatchHandler(std::string const& name, std::function<void(Args...)> callback)
-		: m_selector(name), m_callback(callback) {}
+		: m_selectorID(Dispatcher::getSelectorID(name)), m_callback(callback) {}
 	 public:
-	 	bool handle(DispatchEvent<Args...>* ev) {
-	 		if (ev->name() == m_selector) {
-	 			std::apply(m_callback, ev->m_args);
+	 	PassThrough handle(DispatchEvent<Args...>* ev) override {
+	 		if (ev->selectorID() == m_selectorID) {
+	 			std::apply(m_callback, ev->args());
 	 		}
-	 		return true;
+	 		return PassThrough::Propagate;
 	 	}
 
 	 	static DispatchHandler* create(std::string const& name, std::function<void(Args...)> callback) {
 	 		return new DispatchHandler(name, callback);
 	 	}
 	};
-}
\ No newline at end of file
+
+	template <class>
+	class DispatchFn;
+
+	/**
+	 * Cached handle to a function another mod exposed through
+	 * provideDispatch. Calls are a single atomic load and a
+	 * direct call through a function pointer, and are safe
+	 * from any thread. The handle notices when the providing
+	 * mod unloads or the function is replaced
+	 */
+	template <class R, class... Args>
+	class DispatchFn<R(Args...)> {
+		static_assert(
+			!std::is_reference_v<R>,
+			"Dispatched functions can't return references; return a pointer instead"
+		);
+
+		using Function = R(*)(Args...);
+		using Return = std::conditional_t<std::is_void_v<R>, void, std::optional<R>>;
+
+		impl::DispatchSlot* m_slot;
+		/**
+		 * Last target whose signature was checked and matched, so
+		 * the type_info comparison is only done when it changes.
+		 * Targets are immutable, so everything else is read from
+		 * the target itself
+		 */
+		mutable std::atomic<impl::DispatchTarget const*> m_matched = nullptr;
+
+		impl::DispatchTarget const* resolve() const {
+			auto target = m_slot->m_target.load(std::memory_order_acquire);
+			if (!target || target == m_matched.load(std::memory_order_relaxed)) {
+				return target;
+			}
+			if (*target->m_signature != typeid(R(Args...))) {
+				return nullptr;
+			}
+			m_matched.store(target, std::memory_order_relaxed);
+			return target;
+		}
+
+	public:
+		DispatchFn(std::string const& selector)
+		  : m_slot(Dispatcher::getSlot(Dispatcher::getSelectorID(selector))) {}
+		DispatchFn(DispatchFn const& other) : m_slot(other.m_slot) {}
+
+		/**
+		 * Whether a function with a matching signature is
+		 * currently provided for this selector
+		 */
+		bool isValid() const {
+			return this->resolve() != nullptr;
+		}
+
+		explicit operator bool() const {
+			return this->isValid();
+		}
+
+		/**
+		 * Call the provided function. If there is none, void
+		 * functions fall back to posting a DispatchEvent for
+		 * event-based handlers, and other functions return
+		 * std::nullopt
+		 */
+		Return operator()(Args... args) const {
+			if (auto target = this->resolve()) {
+				auto fn = reinterpret_cast<Function>(target->m_function);
+				if (trace::isEnabled()) {
+					impl::DispatchTraceScope scope(m_slot, target);
+					return fn(args...);
+				}
+				return fn(args...);
+			}
+			if constexpr (std::is_void_v<R>) {
+				DispatchEvent<Args...>(m_slot->m_selector, args...).post();
+			} else {
+				return std::nullopt;
+			}
+		}
+	};
+}
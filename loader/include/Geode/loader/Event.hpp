@@ -2,6 +2,11 @@
 
 #include <Geode/DefaultInclude.hpp>
 #include <type_traits>
+#include <typeinfo>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <new>
 #include "Mod.hpp"
 #include <unordered_set>
 
@@ -14,21 +19,132 @@ namespace geode {
 		Stop,
 	};
 
+	/**
+	 * Function that checks whether an event can be
+	 * received by handlers of a specific event type
+	 */
+	using EventFilter = bool(*)(Event*);
+
 	struct GEODE_DLL BasicEventHandler {
 		virtual PassThrough passThrough(Event*) = 0;
 
+		/**
+		 * The exact event type this handler listens to.
+		 * Handlers are bucketed by this type so posting
+		 * an event only visits handlers that can accept it
+		 */
+		virtual std::type_info const& getEventType() const = 0;
+		/**
+		 * Check whether an event can be passed to
+		 * handlers of this handler's event type
+		 */
+		virtual EventFilter getEventFilter() const = 0;
+
+		/**
+		 * Start receiving events. Handlers with a higher
+		 * priority receive events first; handlers with the
+		 * same priority receive them in the order they
+		 * started listening in. Safe to call while an event
+		 * is being dispatched, in which case the handler
+		 * only receives events posted after the dispatch
+		 */
 		void listen();
+		/**
+		 * Stop receiving events. Safe to call while an
+		 * event is being dispatched
+		 */
 		void unlisten();
+
+		int getPriority() const;
+
+		virtual ~BasicEventHandler();
+
+	protected:
+		int m_priority = 0;
+
+		/**
+		 * Type the handler was registered under; kept so
+		 * that unlisten works from the destructor where
+		 * getEventType can no longer be called
+		 */
+		std::type_info const* m_listenType = nullptr;
+
+		/**
+		 * Called by the event dispatcher with an event
+		 * that has already been checked against
+		 * getEventFilter, so no RTTI cast is needed
+		 */
+		virtual PassThrough dispatch(Event*) = 0;
+
+		friend class Event;
 	};
 
-	class GEODE_DLL Event {
-		static std::unordered_set<BasicEventHandler*> s_handlers;
+	/**
+	 * Events that can be coalesced while queued through
+	 * Event::postAsync or Event::postDeferred. If several
+	 * queued events of the same type return the same merge
+	 * key, only the most recently posted one is delivered.
+	 * Useful for things like progress updates
+	 */
+	template <class T>
+	concept MergeableEvent = requires(T const& ev) {
+		{ ev.getMergeKey() } -> std::convertible_to<size_t>;
+	};
+
+	namespace impl {
+		/**
+		 * Queue node for Event::postAsync. Nodes are recycled
+		 * through a free list, and events that fit are stored
+		 * inline in the node, so queueing an event normally
+		 * doesn't allocate at all. Larger events are moved to
+		 * the heap
+		 */
+		struct GEODE_DLL QueuedEvent {
+			static constexpr size_t INLINE_SIZE = 128;
+
+			QueuedEvent* m_next = nullptr;
+			Mod* m_sender = nullptr;
+			Event* m_event = nullptr;
+			std::type_info const* m_mergeType = nullptr;
+			size_t m_mergeKey = 0;
+			bool m_superseded = false;
+			bool m_inline = false;
+			alignas(std::max_align_t) std::byte m_storage[INLINE_SIZE];
+
+			/**
+			 * Get an empty node from the calling thread's cache
+			 * or the free list, allocating one only if both are
+			 * empty
+			 */
+			static QueuedEvent* alloc();
+			/**
+			 * Destroy the node's event and return it to the
+			 * free list
+			 */
+			static void free(QueuedEvent* node);
+
+			template <class T>
+			void emplace(T&& ev) {
+				if constexpr (sizeof(T) <= INLINE_SIZE && alignof(T) <= alignof(std::max_align_t)) {
+					m_event = new (m_storage) T(std::move(ev));
+					m_inline = true;
+				} else {
+					m_event = new T(std::move(ev));
+					m_inline = false;
+				}
+			}
+		};
+	}
 
-	 	friend BasicEventHandler;
+	class GEODE_DLL Event {
+	 	Mod* m_sender = nullptr;
 
-	 	Mod* m_sender;
+		static void queue(impl::QueuedEvent* ev);
 
 	public:
+		/**
+		 * Get all currently listening handlers
+		 */
 	 	static std::unordered_set<BasicEventHandler*> const& getHandlers();
 
 	 	void postFrom(Mod* sender);
@@ -38,6 +154,55 @@ namespace geode {
 
 	 	Mod* getSender();
 
+		/**
+		 * Queue an event to be posted on the GD thread. Safe
+		 * to call from any thread; the event is delivered the
+		 * next time queued events are processed (once per
+		 * frame). Queueing is lock-free, and doesn't allocate
+		 * for events up to QueuedEvent::INLINE_SIZE bytes once
+		 * the queue has warmed up
+		 * @param ev The event to post. Is moved into the queue
+		 * @param sender The mod posting the event
+		 */
+		template <class T>
+			requires std::is_base_of_v<Event, T> && std::is_move_constructible_v<T>
+		static void postAsync(T ev, Mod* sender = Mod::get()) {
+			auto queued = impl::QueuedEvent::alloc();
+			queued->m_sender = sender;
+			if constexpr (MergeableEvent<T>) {
+				queued->m_mergeType = &typeid(T);
+				queued->m_mergeKey = static_cast<size_t>(ev.getMergeKey());
+			}
+			queued->emplace(std::move(ev));
+			Event::queue(queued);
+		}
+
+		/**
+		 * Post an event on the GD thread during the next frame
+		 * rather than immediately. Same as postAsync; meant for
+		 * code already on the GD thread that wants to batch
+		 * notifications
+		 */
+		template <class T>
+			requires std::is_base_of_v<Event, T> && std::is_move_constructible_v<T>
+		static void postDeferred(T ev, Mod* sender = Mod::get()) {
+			Event::postAsync(std::move(ev), sender);
+		}
+
+		/**
+		 * Post queued events. Events are posted in the order
+		 * they were queued until the time budget runs out;
+		 * events that didn't fit are posted next time. Called
+		 * by the loader once per frame on the GD thread
+		 */
+		static void processQueued();
+		/**
+		 * Set how much time processQueued may spend per frame.
+		 * At least one event is always posted per call
+		 */
+		static void setQueueTimeBudget(std::chrono::microseconds budget);
+		static std::chrono::microseconds getQueueTimeBudget();
+
 	 	virtual ~Event();
 	};
 
@@ -52,8 +217,27 @@ namespace geode {
 			return PassThrough::Propagate;
 		}
 
+		std::type_info const& getEventType() const override {
+			return typeid(T);
+		}
+		EventFilter getEventFilter() const override {
+			return +[](Event* ev) -> bool {
+				return dynamic_cast<T*>(ev) != nullptr;
+			};
+		}
+
 		EventHandler() {
 			listen();
 		}
+
+		EventHandler(int priority) {
+			m_priority = priority;
+			listen();
+		}
+
+	protected:
+		PassThrough dispatch(Event* ev) override {
+			return handle(static_cast<T*>(ev));
+		}
 	};
 }
@@ -9,6 +9,7 @@
 #include <Geode/utils/Result.hpp>
 #include <functional>
 #include <unordered_set>
+#include <optional>
 #include <fs/filesystem.hpp>
 #include "Log.hpp"
 
@@ -52,30 +53,57 @@ namespace geode {
         struct LoaderSettings {
             struct ModSettings {
                 bool m_enabled = true;
+                std::optional<Severity::type> m_logLevel;
             };
             std::unordered_map<std::string, ModSettings> m_mods;
+            bool m_binaryLogs = false;
+            uint32_t m_frameBudget = 50;
+            log::LogRetention m_logRetention;
         };
 
         using ScheduledFunction = std::function<void GEODE_CALL(void)>;
         
         std::vector<ScheduledFunction> m_scheduledFunctions;
         std::unordered_map<std::string, Mod*> m_mods;
-        std::vector<log::Log> m_logs;
-        std::ofstream m_logStream;
+        log::LogStore m_logs;
         std::vector<ghc::filesystem::path> m_modDirectories;
         std::vector<FailedModInfo> m_erroredMods;
         std::vector<ghc::filesystem::path> m_texturePaths;
         LoaderSettings m_loadedSettings;
         bool m_isSetup = false;
+        bool m_resolvingDependencies = false;
+        /**
+         * Whether mods marked as deferred are still being held
+         * back; cleared once the main menu has appeared
+         */
+        bool m_deferringMods = true;
         static bool s_unloading;
 
         Result<std::string> createTempDirectoryForMod(ModInfo const& info);
         Result<Mod*> loadModFromFile(std::string const& file);
+        Result<Mod*> loadModFromInfo(ModInfo const& info);
         size_t loadModsFromDirectory(
             ghc::filesystem::path const& path, bool recursive
         );
         void createDirectories();
 
+        /**
+         * Sort mods into layers where each mod only depends on mods
+         * in earlier layers. Mods stuck in a cycle of required
+         * dependencies, or depending on one, don't get a layer
+         * @param cyclic Filled with the mods that don't get a layer
+         */
+        std::vector<std::vector<Mod*>> getDependencyLayers(std::vector<Mod*>& cyclic) const;
+        /**
+         * Mark the enabled mods that want to be deferred as such,
+         * except for those that a mod loaded at startup depends on
+         */
+        void markDeferredMods();
+        /**
+         * Update the dependencies of every mod, loading or unloading
+         * them as needed. Each mod is visited once, after the mods
+         * it depends on. Deferred mods are skipped
+         */
         void updateAllDependencies();
 
         void releaseScheduledFunctions(Mod* mod);
@@ -174,9 +202,42 @@ namespace geode {
 
         void pushLog(log::Log&& log);
         void popLog(log::Log* log);
-        std::vector<log::Log*> getLogs(
+        /**
+         * Get the recent logs of the given severities, or all
+         * recent logs if the filter is empty, oldest first.
+         * These are copies; pass one to popLog to remove it
+         */
+        std::vector<log::Log> getLogs(
             std::initializer_list<Severity> severityFilter = {}
         );
+        /**
+         * Get the recent logs of a mod, oldest first
+         */
+        std::vector<log::Log> getModLogs(
+            Mod* mod, std::initializer_list<Severity> severityFilter = {}
+        );
+        /**
+         * Store holding recent logs. Use it to change how many
+         * logs of each severity are kept
+         */
+        log::LogStore& getLogStore();
+
+        /**
+         * Write logs in the compact binary format instead of
+         * text. Takes effect the next time the game starts;
+         * the geode-logdump tool converts them to text or JSON
+         */
+        void setBinaryLogs(bool binary);
+        bool isUsingBinaryLogs() const;
+
+        /**
+         * Set how long a frame may take before it's reported as a
+         * hitch, along with what ran during it. Reports go to the
+         * log and to Geode's page in the mod list
+         * @param milliseconds Frame budget, or 0 to stop monitoring
+         */
+        void setFrameBudget(uint32_t milliseconds);
+        uint32_t getFrameBudget() const;
 
         void clearLogs();
 
@@ -250,6 +311,16 @@ namespace geode {
          * @param func Function to run
          */
         void queueInGDThread(ScheduledFunction func);
+        /**
+         * Run a function in the GD thread, replacing any function
+         * queued with the same key that hasn't run yet. Useful for
+         * frequent updates, like download progress, where only
+         * the latest one matters
+         * @param func Function to run
+         * @param key Identifies what the function updates;
+         * usually a pointer to the object it updates
+         */
+        void queueInGDThread(ScheduledFunction func, void const* key);
 
         /**
          * Run a function when the Mod is loaded. Useful if for 
@@ -2,11 +2,20 @@
 
 #include <Geode/DefaultInclude.hpp>
 #include "Types.hpp"
+#include "LogRecord.hpp"
 #include <chrono>
 #include <sstream>
 #include <vector>
 #include <fs/filesystem.hpp>
 #include <ccTypes.h>
+#include <fmt/format.h>
+#include <array>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
 
 #ifndef __cpp_lib_concepts
 namespace std {
@@ -27,10 +36,26 @@ namespace geode {
     inline Mod* getMod();
 
     namespace log {
-        using log_clock = std::chrono::system_clock;
-
         GEODE_DLL std::string generateLogName();
 
+        /**
+         * Get the lowest severity that is logged for mods
+         * without a log level of their own
+         */
+        GEODE_DLL Severity getLogLevel();
+        /**
+         * Set the lowest severity that is logged for mods
+         * without a log level of their own. See
+         * Mod::setLogLevel for setting it per mod
+         */
+        GEODE_DLL void setLogLevel(Severity level);
+        /**
+         * Whether a log of this severity from this mod passes
+         * its log level. A single atomic load; defined in
+         * Mod.hpp
+         */
+        inline bool shouldLog(Severity severity, Mod* mod);
+
         GEODE_DLL std::string parse(cocos2d::CCNode*);
         template <class T>
         requires std::convertible_to<T*, cocos2d::CCNode*>
@@ -60,28 +85,88 @@ namespace geode {
             return buf.str();
         }
 
-        struct GEODE_DLL ComponentTrait {
-            virtual ~ComponentTrait() {}
-            virtual std::string _toString() = 0;
-        };
+        template <class T>
+        concept Loggable = requires(T const& thing) { parse(thing); };
 
-        template <typename T>
-        struct ComponentBase : public ComponentTrait {
-            T m_item;
-            inline ~ComponentBase() override {}
-            inline ComponentBase(T const& item) : m_item(item) {}
-            // specialization must implement
-            inline std::string _toString() override { return parse(m_item); }
-        };
+        /**
+         * Store an argument in a record. Numbers, characters and
+         * strings are copied as they are, without allocating,
+         * and only turned into text on the log writer thread;
+         * anything else goes through parse right away, since it
+         * may not be around by the time the log is written
+         */
+        template <class T>
+        void captureArg(LogRecord& record, T const& thing) {
+            if constexpr (std::is_floating_point_v<T>) {
+                record.putFloat(thing);
+            } else if constexpr (std::is_same_v<T, bool>) {
+                // streams as 1 or 0, like parse would
+                record.putInt(thing);
+            } else if constexpr (std::is_same_v<T, char>) {
+                record.putChar(thing);
+            } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+                record.putInt(thing);
+            } else if constexpr (std::is_integral_v<T>) {
+                record.putUInt(thing);
+            } else if constexpr (std::is_convertible_v<T const&, std::string_view>) {
+                record.putString(thing);
+            } else {
+                record.putString(parse(thing));
+            }
+        }
+
+        namespace impl {
+            // deliberately not constexpr, so reaching this while
+            // checking a format string fails compilation
+            inline void invalidFormatString(const char*) {}
+        }
+
+        /**
+         * Format string checked at compile time. Only empty {}
+         * placeholders are supported; use {{ and }} for literal
+         * braces
+         */
+        template <class... Args>
+        class FormatString {
+            std::string_view m_str;
+
+        public:
+            template <class S>
+            requires std::convertible_to<S const&, std::string_view>
+            consteval FormatString(S const& str) : m_str(str) {
+                size_t placeholders = 0;
+                for (size_t i = 0; i < m_str.size(); i++) {
+                    auto next = i + 1 < m_str.size() ? m_str[i + 1] : '\0';
+                    if (m_str[i] == '{') {
+                        if (next == '{') {
+                            i++;
+                        } else if (next == '}') {
+                            if (placeholders == sizeof...(Args)) {
+                                impl::invalidFormatString("Not enough arguments for format string");
+                                return;
+                            }
+                            placeholders++;
+                            i++;
+                        } else {
+                            impl::invalidFormatString("Only {} placeholders are supported");
+                        }
+                    } else if (m_str[i] == '}') {
+                        if (next == '}') {
+                            i++;
+                        } else {
+                            impl::invalidFormatString("Unescaped } in format string");
+                        }
+                    }
+                }
+                if (placeholders != sizeof...(Args)) {
+                    impl::invalidFormatString("Too many arguments for format string");
+                }
+            }
 
-        /*template <typename T> requires requires(T b) { std::stringstream() << b; }
-        struct Component<T> : ComponentBase<T> {
-            inline static std::string toString(T const& thing) {
-                std::stringstream buf;
-                buf << thing;
-                return buf.str();
+            std::string_view getString() const {
+                return m_str;
             }
-        };*/
+        };
 
         class GEODE_DLL Log {
         private: 
@@ -89,87 +174,250 @@ namespace geode {
         protected:
             Mod* m_sender;
             log_clock::time_point m_time;
-            std::vector<ComponentTrait*> m_components;
+            std::string m_message;
             Severity m_severity;
+            // position among all logs in the store, set when it's
+            // added to one
+            uint64_t m_order = 0;
+            // until the message is needed, what it's put together
+            // from; the format string is empty once it has been
+            std::string_view m_format;
+            std::string m_args;
+
+            /**
+             * Put the message together, if it hasn't been yet
+             */
+            void render();
+
+            friend class LogRing;
+            friend class LogStore;
         
         public:
-            Log(Mod* mod, Severity sev);// : m_sender(mod), m_time(log_clock::now()), m_severity(sev) {}
+            Log(Mod* mod, Severity sev, std::string message);
+            Log(Mod* mod, Severity sev, std::string message, log_clock::time_point time);
+            /**
+             * A log whose message is only put together once the
+             * log store hands it out. The format string must stay
+             * valid for the rest of the process
+             */
+            Log(
+                Mod* mod, Severity sev, log_clock::time_point time,
+                std::string_view format, std::string args
+            );
+            Log(Log const& l) = default;
             Log(Log&& l) = default;
+            Log& operator=(Log const& l) = default;
             Log& operator=(Log&& l) = default;
             bool operator==(Log const& l);
 
             std::string toString(bool logTime = true) const;
             void pushToLoader();
 
-            inline std::vector<ComponentTrait*>& getComponents() { return m_components; }
+            inline std::string const& getMessage() const { return m_message; }
             inline log_clock::time_point getTime() const { return m_time; }
             inline Mod* getSender() const { return m_sender; }
             inline Severity getSeverity() const { return m_severity; }
-            inline ~Log() {
-                for (auto comp : m_components) {
-                    delete comp;
-                }
-            }
 
-            template <typename ...Args>
-            friend void schedule(Severity sev, Args... args);
+            static void schedule(std::function<void(Mod*)> func);
 
             friend void GEODE_DLL releaseSchedules(Mod* m);
         };
 
-        void GEODE_DLL vlogImpl(Severity, Mod*, std::string_view, std::function<void(Log&)>*, size_t);
+        /**
+         * Fixed-capacity ring of logs of one severity. Slots are
+         * allocated once and reused; once full, each new log
+         * overwrites the oldest one. Logs are addressed by their
+         * sequence number, the count of logs pushed before them
+         */
+        class GEODE_DLL LogRing {
+        protected:
+            std::vector<Log> m_logs;
+            std::vector<bool> m_removed;
+            size_t m_capacity;
+            uint64_t m_pushed = 0;
+
+            void push(Log&& log);
+            /**
+             * Resize the ring, renumbering the logs that are kept
+             * to start from zero
+             * @returns The old sequence number of the first log kept
+             */
+            uint64_t setCapacity(size_t capacity);
+            /**
+             * Find a log by its position among all logs
+             * @returns Its sequence number, or getEndSeq() if it's
+             * no longer in the ring
+             */
+            uint64_t find(uint64_t order) const;
+
+            friend class LogStore;
+
+        public:
+            LogRing(size_t capacity = 0);
+
+            size_t getCapacity() const {
+                return m_capacity;
+            }
+            /**
+             * Number of slots in use, including removed logs
+             */
+            size_t size() const {
+                return m_logs.size();
+            }
+            uint64_t getFirstSeq() const {
+                return m_pushed - m_logs.size();
+            }
+            uint64_t getEndSeq() const {
+                return m_pushed;
+            }
+            bool contains(uint64_t seq) const {
+                return seq >= this->getFirstSeq() && seq < m_pushed;
+            }
+            Log* at(uint64_t seq) {
+                return &m_logs[seq % m_capacity];
+            }
+            Log const* at(uint64_t seq) const {
+                return &m_logs[seq % m_capacity];
+            }
+            uint64_t getOrder(uint64_t seq) const {
+                return this->at(seq)->m_order;
+            }
+            bool isRemoved(uint64_t seq) const {
+                return m_removed[seq % m_capacity];
+            }
+        };
+
+        /**
+         * Bounded in-memory store of recent logs, with one ring
+         * per severity and an index of each mod's logs so
+         * filtered queries only touch the logs they return.
+         * Logs are added from the log writer thread, so queries
+         * hand out copies taken under the lock
+         */
+        class GEODE_DLL LogStore {
+        public:
+            static constexpr size_t SEVERITY_COUNT = Severity::Emergency + 1;
+
+        protected:
+            std::array<LogRing, SEVERITY_COUNT> m_rings;
+            // sequence numbers of each mod's logs in each ring,
+            // oldest first
+            std::unordered_map<Mod*, std::array<std::deque<uint64_t>, SEVERITY_COUNT>> m_modIndex;
+            uint64_t m_nextOrder = 0;
+            mutable std::mutex m_mutex;
+
+            /**
+             * Copy out logs, putting together the messages of the
+             * ones that haven't been handed out before
+             */
+            static std::vector<Log> copyLogs(std::vector<Log*> const& logs);
+
+        public:
+            LogStore();
+
+            void push(Log&& log);
+            /**
+             * Remove a log, given it or a copy of it from one of
+             * the queries
+             */
+            void remove(Log const& log);
+            void clear();
+
+            /**
+             * Set how many logs of a severity are kept. Shrinking
+             * drops the oldest ones
+             */
+            void setCapacity(Severity severity, size_t capacity);
+            size_t getCapacity(Severity severity) const;
+
+            /**
+             * Get the logs of the given severities, or all logs if
+             * the filter is empty, oldest first
+             */
+            std::vector<Log> getLogs(std::initializer_list<Severity> severityFilter);
+            /**
+             * Get the logs of a mod, oldest first
+             */
+            std::vector<Log> getModLogs(
+                Mod* mod, std::initializer_list<Severity> severityFilter
+            );
+        };
 
-        template <typename... Args>
-        requires requires(Args... b) { (parse(b), ...); }
-        void log(Severity severity, Mod* mod, std::string_view formatStr, Args... args) {
-            static constexpr auto pushSomething = [](Log& log, auto something) {
-                // i think this line of code is very sad
-                log.getComponents().push_back(new ComponentBase(something));
-            };
+        /**
+         * Timestamp a record and hand it to the log writer
+         */
+        void GEODE_DLL vlogImpl(Mod* mod, LogRecord& record);
 
-            std::array<std::function<void(Log&)>, sizeof...(Args)> comps = { [&](Log& log) { pushSomething(log, args); }... };
-            // tfw no std::span
-            vlogImpl(severity, mod, formatStr, comps.data(), comps.size());
+        template <Loggable... Args>
+        void log(
+            Severity severity, Mod* mod,
+            FormatString<std::type_identity_t<Args>...> formatStr,
+            Args const&... args
+        ) {
+            // checked before converting any argument, so filtered
+            // out logs cost nothing else
+            if (!shouldLog(severity, mod)) return;
+            LogRecord record;
+            record.m_severity = static_cast<uint8_t>(severity.m_value);
+            record.m_format = formatStr.getString();
+            (captureArg(record, args), ...);
+            vlogImpl(mod, record);
         }
 
         void GEODE_DLL releaseSchedules(Mod* m);
 
-        template <typename ...Args>
-        void schedule(Severity sev, Args... args) {
+        template <Loggable... Args>
+        void schedule(
+            Severity sev,
+            FormatString<std::type_identity_t<Args>...> formatStr,
+            Args const&... args
+        ) {
             auto m = getMod();
-            if (m) return log(sev, m, args...);
+            if (m) return log(sev, m, formatStr, args...);
 
-            Log::scheduled().push_back([=](Mod* m2){
-                log(sev, m2, args...);
+            Log::schedule([=](Mod* m2) {
+                log(sev, m2, formatStr, args...);
             });
         }
 
-        template <typename ...Args>
-        void debug(Args... args) { 
-        #ifdef GEODE_DEBUG
-            schedule(Severity::Debug, args...); 
-        #endif
+        template <class... Args>
+        void debug(FormatString<std::type_identity_t<Args>...> formatStr, Args const&... args) {
+            schedule(Severity::Debug, formatStr, args...);
         }
 
-        template <typename ...Args>
-        void info(Args... args) { schedule(Severity::Info, args...); }
+        template <class... Args>
+        void info(FormatString<std::type_identity_t<Args>...> formatStr, Args const&... args) {
+            schedule(Severity::Info, formatStr, args...);
+        }
 
-        template <typename ...Args>
-        void notice(Args... args) { schedule(Severity::Notice, args...); }
+        template <class... Args>
+        void notice(FormatString<std::type_identity_t<Args>...> formatStr, Args const&... args) {
+            schedule(Severity::Notice, formatStr, args...);
+        }
 
-        template <typename ...Args>
-        void warn(Args... args) { schedule(Severity::Warning, args...); }
+        template <class... Args>
+        void warn(FormatString<std::type_identity_t<Args>...> formatStr, Args const&... args) {
+            schedule(Severity::Warning, formatStr, args...);
+        }
 
-        template <typename ...Args>
-        void error(Args... args) { schedule(Severity::Error, args...); }
+        template <class... Args>
+        void error(FormatString<std::type_identity_t<Args>...> formatStr, Args const&... args) {
+            schedule(Severity::Error, formatStr, args...);
+        }
 
-        template <typename ...Args>
-        void critical(Args... args) { schedule(Severity::Critical, args...); }
+        template <class... Args>
+        void critical(FormatString<std::type_identity_t<Args>...> formatStr, Args const&... args) {
+            schedule(Severity::Critical, formatStr, args...);
+        }
 
-        template <typename ...Args>
-        void alert(Args... args) { schedule(Severity::Alert, args...); }
+        template <class... Args>
+        void alert(FormatString<std::type_identity_t<Args>...> formatStr, Args const&... args) {
+            schedule(Severity::Alert, formatStr, args...);
+        }
 
-        template <typename ...Args>
-        void emergency(Args... args) { schedule(Severity::Emergency, args...); }
+        template <class... Args>
+        void emergency(FormatString<std::type_identity_t<Args>...> formatStr, Args const&... args) {
+            schedule(Severity::Emergency, formatStr, args...);
+        }
     }
 }
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <fmt/format.h>
+#include <chrono>
+#include <compare>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+// Kept free of the rest of Geode so the log writer can be built
+// and benchmarked without the game
+
+namespace geode::log {
+    using log_clock = std::chrono::system_clock;
+
+    /**
+     * Which logs from previous sessions are kept in the
+     * logs directory. Enforced on startup, off the main
+     * thread; anything past any of the limits is deleted
+     */
+    struct LogRetention {
+        /**
+         * Most log files kept, including the current one
+         */
+        size_t m_maxFiles = 30;
+        uintmax_t m_maxBytes = 256ull * 1024 * 1024;
+        std::chrono::hours m_maxAge = std::chrono::hours(24 * 14);
+        /**
+         * Whether to gzip the logs that are kept
+         */
+        bool m_compress = true;
+    };
+
+    /**
+     * How an argument is stored in a LogRecord: a u8 kind, then
+     * 8 bytes for numbers, 1 byte for characters, or a u32 size
+     * and the bytes for strings
+     */
+    enum class LogArgKind : uint8_t {
+        Int = 1,
+        UInt = 2,
+        Float = 3,
+        Char = 4,
+        String = 5,
+    };
+
+    /**
+     * Who logged a record. Captured on the logging thread and kept
+     * for the rest of the process, so the writer never has to look
+     * at the mod itself, which may have been unloaded by then
+     */
+    struct LogSender {
+        std::string m_id;
+        std::string m_name;
+
+        auto operator<=>(LogSender const&) const = default;
+    };
+
+    /**
+     * A log on its way from the logging thread to the log writer.
+     * Only the format string and the raw arguments are captured;
+     * the message is put together on the writer thread. Arguments
+     * are stored inline, so making a record doesn't allocate unless
+     * they take up more than INLINE_ARGS bytes (a number takes 9,
+     * a string 5 plus its length)
+     */
+    struct LogRecord {
+        static constexpr size_t INLINE_ARGS = 224;
+
+        log_clock::time_point m_time;
+        /**
+         * The Mod that logged this, handed back to the loader's
+         * log store. The writer never looks at it
+         */
+        void* m_mod = nullptr;
+        /**
+         * From LogSink::getSender, so the same sender is always
+         * the same pointer
+         */
+        LogSender const* m_sender = nullptr;
+        /**
+         * Checked at compile time, so it always points to a
+         * string literal. Mods have their logs written out before
+         * they're unloaded, so it stays valid until then
+         */
+        std::string_view m_format;
+        uint8_t m_severity = 0;
+        uint8_t m_argCount = 0;
+        uint16_t m_inlineSize = 0;
+        unsigned char m_inlineArgs[INLINE_ARGS];
+        /**
+         * All of the arguments, once they don't fit inline
+         */
+        std::string m_spilledArgs;
+
+        void append(void const* data, size_t size) {
+            if (m_spilledArgs.empty() && m_inlineSize + size <= INLINE_ARGS) {
+                std::memcpy(m_inlineArgs + m_inlineSize, data, size);
+                m_inlineSize += static_cast<uint16_t>(size);
+                return;
+            }
+            if (m_spilledArgs.empty()) {
+                m_spilledArgs.assign(reinterpret_cast<char const*>(m_inlineArgs), m_inlineSize);
+            }
+            m_spilledArgs.append(static_cast<char const*>(data), size);
+        }
+
+        template <class T>
+        void putRaw(LogArgKind kind, T value) {
+            char bytes[sizeof(T) + 1];
+            bytes[0] = static_cast<char>(kind);
+            std::memcpy(bytes + 1, &value, sizeof(T));
+            this->append(bytes, sizeof(bytes));
+            m_argCount++;
+        }
+
+        void putInt(int64_t value) {
+            this->putRaw(LogArgKind::Int, value);
+        }
+        void putUInt(uint64_t value) {
+            this->putRaw(LogArgKind::UInt, value);
+        }
+        void putFloat(double value) {
+            this->putRaw(LogArgKind::Float, value);
+        }
+        void putChar(char value) {
+            this->putRaw(LogArgKind::Char, value);
+        }
+        void putString(std::string_view value) {
+            this->putRaw(LogArgKind::String, static_cast<uint32_t>(value.size()));
+            this->append(value.data(), value.size());
+        }
+
+        std::string_view getArgs() const {
+            if (m_spilledArgs.size()) {
+                return m_spilledArgs;
+            }
+            return std::string_view(reinterpret_cast<char const*>(m_inlineArgs), m_inlineSize);
+        }
+    };
+
+    /**
+     * Turns the arguments of a LogRecord back into text, one at
+     * a time. Never reads past the end, so it's also safe to use
+     * on arguments read back from a file
+     */
+    class LogArgReader {
+        std::string_view m_data;
+        size_t m_offset = 0;
+
+        template <class T>
+        bool get(T& value) {
+            if (m_data.size() - m_offset < sizeof(T)) return false;
+            std::memcpy(&value, m_data.data() + m_offset, sizeof(T));
+            m_offset += sizeof(T);
+            return true;
+        }
+
+    public:
+        LogArgReader(std::string_view data) : m_data(data) {}
+
+        bool done() const {
+            return m_offset >= m_data.size();
+        }
+
+        /**
+         * Append the next argument's text
+         * @returns False if there are no arguments left or the
+         * data is malformed
+         */
+        bool renderNext(std::string& out) {
+            LogArgKind kind;
+            if (!this->get(kind)) return false;
+            auto it = std::back_inserter(out);
+            switch (kind) {
+                case LogArgKind::Int: {
+                    int64_t value;
+                    if (!this->get(value)) return false;
+                    fmt::format_to(it, "{}", value);
+                } return true;
+
+                case LogArgKind::UInt: {
+                    uint64_t value;
+                    if (!this->get(value)) return false;
+                    fmt::format_to(it, "{}", value);
+                } return true;
+
+                case LogArgKind::Float: {
+                    double value;
+                    if (!this->get(value)) return false;
+                    // same as streaming it
+                    fmt::format_to(it, "{:g}", value);
+                } return true;
+
+                case LogArgKind::Char: {
+                    char value;
+                    if (!this->get(value)) return false;
+                    out.push_back(value);
+                } return true;
+
+                case LogArgKind::String: {
+                    uint32_t size;
+                    if (!this->get(size)) return false;
+                    if (m_data.size() - m_offset < size) return false;
+                    out.append(m_data.data() + m_offset, size);
+                    m_offset += size;
+                } return true;
+            }
+            return false;
+        }
+    };
+
+    /**
+     * Put a log's arguments into its format string. Only empty {}
+     * placeholders are supported, and {{ and }} are single braces
+     */
+    inline void renderLog(std::string& out, std::string_view format, std::string_view args) {
+        LogArgReader reader(args);
+        for (size_t i = 0; i < format.size(); i++) {
+            auto next = i + 1 < format.size() ? format[i + 1] : '\0';
+            if (format[i] == '{' && next == '}') {
+                reader.renderNext(out);
+                i++;
+            } else if ((format[i] == '{' && next == '{') || (format[i] == '}' && next == '}')) {
+                out.push_back(format[i]);
+                i++;
+            } else {
+                out.push_back(format[i]);
+            }
+        }
+    }
+}
@@ -7,12 +7,14 @@
 #include <Geode/utils/Result.hpp>
 #include <Geode/utils/VersionInfo.hpp>
 #include <Geode/utils/json.hpp>
+#include <Geode/utils/TrackedJson.hpp>
 #include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <type_traits>
 #include "Setting.hpp"
 #include <optional>
+#include <atomic>
 
 class InternalLoader;
 class InternalMod;
@@ -155,6 +157,11 @@ namespace geode {
          * Whether the mod can be unloaded or not
          */
         bool m_supportsUnloading = false;
+        /**
+         * Whether the mod can wait to be loaded until after the
+         * main menu has appeared. Set through "load": "deferred"
+         */
+        bool m_deferLoad = false;
         /**
          * Create ModInfo from a .geode package
          */
@@ -191,21 +198,31 @@ namespace geode {
      * when the datastore changes
      */
     class GEODE_DLL DataStore {
-        nlohmann::json m_store;
         Mod* m_mod;
+        /**
+         * The mod's datastore generation when this was created
+         */
+        size_t m_generation;
 
-        DataStore(Mod* m, nlohmann::json& j) : m_mod(m), m_store(j) {}
+        DataStore(Mod* m);
         
         friend class Mod;
 
     public:
         ~DataStore();
 
-        nlohmann::json& getJson() const;
-        nlohmann::json& operator[](std::string const&);
-        DataStore& operator=(nlohmann::json&);
+        /**
+         * Only assigning through these, or calling write() on them,
+         * counts as a change; reading through them doesn't make the
+         * datastore be saved. Changes are saved when the DataStore
+         * that's alive at the time is destroyed
+         */
+        TrackedJson getJson() const;
+        TrackedJson operator[](std::string const&) const;
+        DataStore& operator=(nlohmann::json const&);
+        nlohmann::json const& at(std::string const&) const;
         bool contains(std::string const&) const;
-        operator nlohmann::json();
+        operator nlohmann::json() const;
 
     };
 
@@ -244,6 +261,11 @@ namespace geode {
          * Whether the mod is loadable or not
          */
         bool m_resolved = false;
+        /**
+         * Whether the mod is waiting to be loaded after the main
+         * menu has appeared
+         */
+        bool m_deferred = false;
         /**
          * Mod temp directory name
          */
@@ -296,6 +318,27 @@ namespace geode {
          * Data Store object
          */
         nlohmann::json m_dataStore;
+        /**
+         * Bumped whenever the datastore is written to,
+         * so DataStore can tell if it changed without comparing it
+         */
+        size_t m_dataStoreGeneration = 0;
+        /**
+         * Whether settings.json and ds.json have changed since they
+         * were last saved. Set from whichever thread made the change
+         */
+        std::atomic<bool> m_settingsDirty = false;
+        std::atomic<bool> m_dataStoreDirty = false;
+        /**
+         * Lowest severity of this mod's logs that are logged.
+         * Atomic so any thread can check it before formatting
+         */
+        std::atomic<Severity::type> m_logLevel;
+        /**
+         * Log level set for this mod specifically. If unset,
+         * the global log level applies
+         */
+        std::optional<Severity::type> m_logLevelOverride;
 
         /**
          * Load the platform binary
@@ -350,6 +393,12 @@ namespace geode {
         VersionInfo getVersion() const;
         bool        isEnabled() const;
         bool        isLoaded() const;
+        /**
+         * Whether the mod has been put off until after the main menu
+         * has appeared and hasn't been loaded yet. Until it is, the
+         * mod isn't loaded and nothing loaded depends on it
+         */
+        bool        isLoadDeferred() const;
         bool        supportsDisabling() const;
         bool        supportsUnloading() const;
         bool        wasSuccesfullyLoaded() const;
@@ -517,6 +566,27 @@ namespace geode {
         Result<> uninstall();
         bool isUninstalled() const;
 
+        /**
+         * Get the lowest severity of this mod's logs that
+         * are logged
+         */
+        inline Severity getLogLevel() const {
+            return m_logLevel.load(std::memory_order_relaxed);
+        }
+        /**
+         * Only log messages from this mod that are at least
+         * this severe. Logs below the level aren't formatted
+         * at all
+         * @param level The level, or std::nullopt to follow
+         * the global log level again
+         */
+        void setLogLevel(std::optional<Severity> level);
+        /**
+         * Get the log level set for this mod specifically,
+         * if any
+         */
+        std::optional<Severity> getLogLevelOverride() const;
+
         /**
          * Return the data store object
          * @returns DataStore object
@@ -574,6 +644,15 @@ namespace geode {
     inline GEODE_HIDDEN Mod* getMod() {
         return Mod::get();
     }
+
+    namespace log {
+        inline bool shouldLog(Severity severity, Mod* mod) {
+            if (mod) {
+                return severity.m_value >= mod->getLogLevel().m_value;
+            }
+            return severity.m_value >= getLogLevel().m_value;
+        }
+    }
 }
 
 inline const char* operator"" _spr(const char* str, size_t) {
@@ -75,6 +75,12 @@ namespace geode {
 
         virtual SettingNode* createNode(float width) = 0;
 
+        /**
+         * Call whenever the value changes. Posts SettingChangedEvent
+         * and marks the mod's settings to be saved; settings that
+         * change without calling this aren't saved until something
+         * else changes
+         */
         void valueChanged();
 
         std::string getKey() const;
@@ -134,7 +140,9 @@ namespace geode {
                 GEODE_INT_PARSE_SETTING_IMPL(obj, parseMinMax, IMinMax<ValueType>);
                 GEODE_INT_PARSE_SETTING_IMPL(obj, parseOneOf,  IOneOf<Class, ValueType>);
                 GEODE_INT_PARSE_SETTING_IMPL(obj, parseMatch,  IMatch<Class, ValueType>);
-                res->setValue(res->m_default);
+                // parsed while mods are being loaded, possibly off the
+                // GD thread, so nothing is notified about the default
+                res->assignValue(res->m_default);
 
                 if (auto controls = obj.has("control").obj()) {
                     // every built-in setting type has a reset button 
@@ -172,7 +180,11 @@ namespace geode {
                 return m_value;
             }
 
-            void setValue(ValueType const& value) {
+            /**
+             * Set the value, constrained to what the setting
+             * allows, without calling valueChanged
+             */
+            void assignValue(ValueType const& value) {
                 m_value = value;
                 if constexpr (std::is_base_of_v<IMinMax<ValueType>, Class>) {
                     (void)static_cast<Class*>(this)->constrainMinMax(m_value);
@@ -183,6 +195,10 @@ namespace geode {
                 if constexpr (std::is_base_of_v<IMatch<Class, ValueType>, Class>) {
                     (void)static_cast<Class*>(this)->constrainMatch(m_value);
                 }
+            }
+
+            void setValue(ValueType const& value) {
+                this->assignValue(value);
                 this->valueChanged();
             }
 
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <Geode/DefaultInclude.hpp>
+#include <Geode/utils/Result.hpp>
+#include <fs/filesystem.hpp>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace geode {
+    class Mod;
+}
+
+/**
+ * Opt-in tracing of the loader and of mods, such as event
+ * propagation, mod-to-mod dispatch and anything mods mark with
+ * GEODE_TRACE_SCOPE. Records go into lock-free per-thread ring
+ * buffers and can be exported in the Chrome trace_event format,
+ * which can be opened in chrome://tracing or Perfetto
+ */
+namespace geode::trace {
+    /**
+     * Kind of a trace record; maps to a Chrome trace_event phase
+     */
+    enum class Phase : char {
+        Complete   = 'X',
+        Instant    = 'i',
+        Counter    = 'C',
+        AsyncBegin = 'b',
+        AsyncEnd   = 'e',
+    };
+
+    /**
+     * A single trace record. Strings should be string literals or
+     * type names from typeid, as each address is only copied the
+     * first time it's recorded; the copy is what's exported, so
+     * it's fine for the mod they came from to be unloaded
+     */
+    struct Record {
+        const char* m_name = nullptr;
+        const char* m_category = nullptr;
+        Phase m_phase = Phase::Complete;
+        /**
+         * Nanoseconds since the trace clock's epoch
+         */
+        uint64_t m_start = 0;
+        uint64_t m_duration = 0;
+        /**
+         * Mod the record is attributed to. Only read by record,
+         * which stores a copy of the mod's ID in m_modID instead
+         */
+        Mod* m_mod = nullptr;
+        /**
+         * ID of the mod the record is attributed to, filled in by
+         * record. Kept as a string since the mod may be unloaded
+         * before the record is exported
+         */
+        const char* m_modID = nullptr;
+        /**
+         * Extra information, like the event type for
+         * handler records
+         */
+        const char* m_detail = nullptr;
+        /**
+         * Whether an event handler returned PassThrough::Stop
+         */
+        bool m_stopped = false;
+        /**
+         * Value of a counter record
+         */
+        int64_t m_value = 0;
+        /**
+         * Ties together the begin and end of an async record
+         */
+        uint64_t m_id = 0;
+    };
+
+    GEODE_DLL std::atomic<bool> const& getEnabledFlag();
+
+    /**
+     * Check whether tracing is on. Cheap enough to call on hot
+     * paths; when tracing is off nothing else should be done
+     */
+    inline bool isEnabled() {
+        static auto& flag = getEnabledFlag();
+        return flag.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Start or stop a capture. Records may still be collected
+     * while no capture is running if something else, such as the
+     * hitch monitor, keeps tracing on in the background
+     */
+    GEODE_DLL void setEnabled(bool enabled);
+    /**
+     * Check whether a capture started through setEnabled is running
+     */
+    GEODE_DLL bool isCapturing();
+    /**
+     * Keep tracing on regardless of captures, so the most recent
+     * records are always there to look back on
+     */
+    GEODE_DLL void setBackground(bool background);
+
+    /**
+     * Current time on the trace clock in nanoseconds
+     */
+    GEODE_DLL uint64_t now();
+
+    /**
+     * Add a record to the calling thread's trace buffer. If the
+     * buffer is full, the oldest records are overwritten. Threads
+     * only get a buffer while a capture is running, or once they
+     * ask for their own records through getThreadRecords
+     */
+    GEODE_DLL void record(Record const& record);
+
+    /**
+     * Forget everything cached about a mod. Called by the loader
+     * before a mod is freed, so a mod that later ends up at the
+     * same address isn't mistaken for it
+     */
+    GEODE_DLL void forgetMod(Mod* mod);
+
+    /**
+     * Get the calling thread's records that overlap a time range,
+     * newest first
+     * @param from Start of the range on the trace clock
+     * @param to End of the range on the trace clock
+     */
+    GEODE_DLL std::vector<Record> getThreadRecords(uint64_t from, uint64_t to);
+
+    /**
+     * Get a record's name in readable form, demangling type names
+     */
+    GEODE_DLL std::string getName(Record const& record);
+
+    /**
+     * Drop every record collected so far, and free the buffers
+     * of threads that have exited
+     */
+    GEODE_DLL void clear();
+
+    /**
+     * Get every collected record as Chrome trace_event JSON
+     */
+    GEODE_DLL std::string exportChromeTrace();
+    /**
+     * Get the given records as Chrome trace_event JSON, as if they
+     * were all recorded on one thread
+     */
+    GEODE_DLL std::string exportChromeTrace(std::vector<Record> const& records);
+    /**
+     * Write every collected record as Chrome trace_event JSON
+     * @param path File to write
+     */
+    GEODE_DLL Result<> saveChromeTrace(ghc::filesystem::path const& path);
+
+    /**
+     * Records how long it's in scope, if tracing was on when it
+     * was created. Usually made through GEODE_TRACE_SCOPE
+     */
+    class Scope {
+    protected:
+        const char* m_name;
+        const char* m_category;
+        Mod* m_mod;
+        uint64_t m_start = 0;
+        bool m_active;
+
+    public:
+        Scope(const char* name, Mod* mod = nullptr, const char* category = "mod")
+          : m_name(name), m_category(category), m_mod(mod), m_active(isEnabled()) {
+            if (m_active) {
+                m_start = now();
+            }
+        }
+        ~Scope() {
+            if (m_active) {
+                record({
+                    .m_name = m_name,
+                    .m_category = m_category,
+                    .m_phase = Phase::Complete,
+                    .m_start = m_start,
+                    .m_duration = now() - m_start,
+                    .m_mod = m_mod,
+                });
+            }
+        }
+
+        Scope(Scope const&) = delete;
+        Scope& operator=(Scope const&) = delete;
+    };
+
+    /**
+     * Record the current value of a counter, such as a queue's
+     * length. Shown as a graph over time
+     */
+    inline void counter(const char* name, int64_t value, Mod* mod = nullptr) {
+        if (!isEnabled()) return;
+        record({
+            .m_name = name,
+            .m_category = "counter",
+            .m_phase = Phase::Counter,
+            .m_start = now(),
+            .m_mod = mod,
+            .m_value = value,
+        });
+    }
+
+    /**
+     * Mark the start of an operation that may end on another
+     * thread or frame, such as a web request
+     * @param id Identifies the operation; the same name and ID
+     * must be passed to asyncEnd
+     */
+    inline void asyncBegin(const char* name, uint64_t id, Mod* mod = nullptr) {
+        if (!isEnabled()) return;
+        record({
+            .m_name = name,
+            .m_category = "async",
+            .m_phase = Phase::AsyncBegin,
+            .m_start = now(),
+            .m_mod = mod,
+            .m_id = id,
+        });
+    }
+
+    inline void asyncEnd(const char* name, uint64_t id, Mod* mod = nullptr) {
+        if (!isEnabled()) return;
+        record({
+            .m_name = name,
+            .m_category = "async",
+            .m_phase = Phase::AsyncEnd,
+            .m_start = now(),
+            .m_mod = mod,
+            .m_id = id,
+        });
+    }
+}
+
+// these attribute records to the calling mod, so Geode/loader/Mod.hpp
+// must be included where they're used
+
+#define GEODE_TRACE_SCOPE(name) \
+    ::geode::trace::Scope GEODE_CONCAT(geodeTraceScope_, __LINE__)(name, ::geode::getMod())
+
+#define GEODE_TRACE_COUNTER(name, value) \
+    ::geode::trace::counter(name, value, ::geode::getMod())
+
+#define GEODE_TRACE_ASYNC_BEGIN(name, id) \
+    ::geode::trace::asyncBegin(name, id, ::geode::getMod())
+
+#define GEODE_TRACE_ASYNC_END(name, id) \
+    ::geode::trace::asyncEnd(name, id, ::geode::getMod())
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "json.hpp"
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace geode {
+    /**
+     * Refers to a value in a json document and counts the writes
+     * made through it, so the document can be checked for changes
+     * by comparing a counter instead of the whole document. Reading
+     * doesn't count, and doesn't create values that aren't there
+     */
+    class TrackedJson {
+    protected:
+        /**
+         * One step from the root to the value: a key into an
+         * object, or an index into an array. Kept apart so a key
+         * like "42" never turns into an array index
+         */
+        struct Step {
+            std::string m_key;
+            size_t m_index = 0;
+            bool m_isIndex = false;
+        };
+
+        nlohmann::json* m_root;
+        size_t* m_generation;
+        std::vector<Step> m_path;
+
+        TrackedJson(TrackedJson const& parent, Step step)
+          : m_root(parent.m_root), m_generation(parent.m_generation), m_path(parent.m_path) {
+            m_path.push_back(std::move(step));
+        }
+
+    public:
+        TrackedJson(nlohmann::json& root, size_t& generation)
+          : m_root(&root), m_generation(&generation) {}
+
+        TrackedJson(TrackedJson const&) = default;
+
+        TrackedJson operator[](std::string const& key) const {
+            return TrackedJson(*this, Step { key });
+        }
+        TrackedJson operator[](size_t index) const {
+            return TrackedJson(*this, Step { {}, index, true });
+        }
+
+        /**
+         * Get the value, or null if there is none
+         */
+        nlohmann::json const& read() const {
+            static nlohmann::json const null;
+            nlohmann::json const* value = m_root;
+            for (auto const& step : m_path) {
+                if (step.m_isIndex) {
+                    if (!value->is_array() || step.m_index >= value->size()) {
+                        return null;
+                    }
+                    value = &(*value)[step.m_index];
+                } else {
+                    if (!value->is_object()) {
+                        return null;
+                    }
+                    auto it = value->find(step.m_key);
+                    if (it == value->end()) {
+                        return null;
+                    }
+                    value = &*it;
+                }
+            }
+            return *value;
+        }
+
+        bool contains(std::string const& key) const {
+            auto const& value = this->read();
+            return value.is_object() && value.contains(key);
+        }
+
+        template <class T>
+        T get() const {
+            return this->read().template get<T>();
+        }
+
+        template <class T>
+        operator T() const {
+            return this->get<T>();
+        }
+
+        template <class T>
+        bool operator==(T const& other) const {
+            return this->read() == other;
+        }
+
+        /**
+         * Get the value to change it in place, creating it if it
+         * doesn't exist. Counts as a write
+         */
+        nlohmann::json& write() const {
+            ++*m_generation;
+            auto value = m_root;
+            for (auto const& step : m_path) {
+                value = step.m_isIndex ? &(*value)[step.m_index] : &(*value)[step.m_key];
+            }
+            return *value;
+        }
+
+        template <class T>
+            requires (!std::is_same_v<std::remove_cvref_t<T>, TrackedJson>)
+        TrackedJson& operator=(T&& value) {
+            this->write() = std::forward<T>(value);
+            return *this;
+        }
+
+        /**
+         * Copies the other value here, rather than pointing this
+         * at it
+         */
+        TrackedJson& operator=(TrackedJson const& other) {
+            this->write() = other.read();
+            return *this;
+        }
+    };
+}
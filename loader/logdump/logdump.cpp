@@ -0,0 +1,210 @@
+#include <BinaryLog.hpp>
+#include <Geode/loader/LogRecord.hpp>
+#include <fmt/format.h>
+#include <fmt/chrono.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace binlog;
+
+static void printUsage() {
+    std::cout <<
+        "Usage: geode-logdump <file.glog> [options]\n"
+        "Options:\n"
+        "  --json              Print one JSON object per log\n"
+        "  --mod <id>          Only print logs from this mod\n"
+        "  --severity <name>   Only print logs at least this severe\n";
+}
+
+static std::string escapeJSON(std::string_view str) {
+    std::string res;
+    res.reserve(str.size());
+    for (auto c : str) {
+        switch (c) {
+            case '"':  res += "\\\""; break;
+            case '\\': res += "\\\\"; break;
+            case '\n': res += "\\n"; break;
+            case '\r': res += "\\r"; break;
+            case '\t': res += "\\t"; break;
+            default: {
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    res += fmt::format("\\u{:04x}", c);
+                } else {
+                    res += c;
+                }
+            } break;
+        }
+    }
+    return res;
+}
+
+/**
+ * Put a log's arguments back into its format string
+ */
+static std::string render(std::string_view format, std::vector<std::string> const& args) {
+    std::string res;
+    size_t arg = 0;
+    for (size_t i = 0; i < format.size(); i++) {
+        auto next = i + 1 < format.size() ? format[i + 1] : '\0';
+        if (format[i] == '{' && next == '}') {
+            if (arg < args.size()) {
+                res += args[arg++];
+            }
+            i++;
+        } else if ((format[i] == '{' && next == '{') || (format[i] == '}' && next == '}')) {
+            res += format[i];
+            i++;
+        } else {
+            res += format[i];
+        }
+    }
+    return res;
+}
+
+static std::optional<uint8_t> severityFromName(std::string const& name) {
+    for (size_t i = 0; i < std::size(SEVERITY_NAMES); i++) {
+        if (name == SEVERITY_NAMES[i]) {
+            return static_cast<uint8_t>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+
+    bool json = false;
+    std::optional<std::string> modFilter;
+    uint8_t minSeverity = 0;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--json") {
+            json = true;
+        } else if (arg == "--mod" && i + 1 < argc) {
+            modFilter = argv[++i];
+        } else if (arg == "--severity" && i + 1 < argc) {
+            auto sev = severityFromName(argv[++i]);
+            if (!sev) {
+                std::cerr << "Unknown severity \"" << argv[i] << "\"\n";
+                return 1;
+            }
+            minSeverity = sev.value();
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file) {
+        std::cerr << "Unable to open " << argv[1] << "\n";
+        return 1;
+    }
+    std::stringstream buf;
+    buf << file.rdbuf();
+    auto data = buf.str();
+
+    Reader reader(data);
+    auto version = reader.getHeader();
+    if (!version) {
+        std::cerr << argv[1] << " is not a Geode binary log, or was written by an unsupported version\n";
+        return 1;
+    }
+
+    std::unordered_map<uint32_t, std::string_view> formats;
+    std::unordered_map<uint32_t, std::string_view> mods;
+    std::vector<std::string> args;
+
+    while (!reader.done()) {
+        Tag tag;
+        if (!reader.get(tag)) break;
+
+        if (tag == Tag::Format || tag == Tag::Mod) {
+            uint32_t id;
+            std::string_view str;
+            if (!reader.get(id) || !reader.getString(str)) break;
+            (tag == Tag::Format ? formats : mods)[id] = str;
+            continue;
+        }
+        if (tag != Tag::Record) {
+            std::cerr << "Unknown entry in log, stopping\n";
+            return 1;
+        }
+
+        int64_t time;
+        uint32_t modID, formatID;
+        uint8_t severity;
+        if (
+            !reader.get(time) || !reader.get(modID) ||
+            !reader.get(severity) || !reader.get(formatID)
+        ) break;
+
+        args.clear();
+        bool complete = true;
+        if (version == 1) {
+            // arguments already turned into text
+            uint16_t argCount;
+            if (!reader.get(argCount)) break;
+            for (uint16_t i = 0; i < argCount; i++) {
+                std::string_view arg;
+                if (!reader.getString(arg)) {
+                    complete = false;
+                    break;
+                }
+                args.emplace_back(arg);
+            }
+        } else {
+            uint8_t argCount;
+            std::string_view raw;
+            if (!reader.get(argCount) || !reader.getString(raw)) break;
+            geode::log::LogArgReader argReader(raw);
+            for (uint8_t i = 0; i < argCount; i++) {
+                if (!argReader.renderNext(args.emplace_back())) {
+                    args.pop_back();
+                    break;
+                }
+            }
+        }
+        if (!complete) break;
+
+        auto mod = mods.count(modID) ? mods.at(modID) : "?";
+        if (severity < minSeverity) continue;
+        if (modFilter && mod != modFilter.value()) continue;
+
+        auto format = formats.count(formatID) ? formats.at(formatID) : "{}";
+        auto message = render(format, args);
+        auto sevName = severity < std::size(SEVERITY_NAMES) ? SEVERITY_NAMES[severity] : "?";
+
+        if (json) {
+            std::string jsonArgs;
+            for (auto& arg : args) {
+                if (jsonArgs.size()) jsonArgs += ",";
+                jsonArgs += "\"" + escapeJSON(arg) + "\"";
+            }
+            fmt::print(
+                "{{\"time\":{},\"mod\":\"{}\",\"severity\":\"{}\","
+                "\"format\":\"{}\",\"args\":[{}],\"message\":\"{}\"}}\n",
+                time, escapeJSON(mod), sevName,
+                escapeJSON(format), jsonArgs, escapeJSON(message)
+            );
+        } else {
+            auto point = std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    std::chrono::nanoseconds(time)
+                )
+            );
+            fmt::print("{:%H:%M:%S} {} [{}]: {}\n", point, sevName, mod, message);
+        }
+    }
+    return 0;
+}
@@ -448,6 +448,7 @@ struct ZipEntryInfo
 {
     unz_file_pos pos;
     uLong uncompressed_size;
+    uLong crc;
 };
 
 class ZipFilePrivate
@@ -518,6 +519,7 @@ bool ZipFile::setFilter(const std::string &filter, ZipFilePrivate *data)
                     ZipEntryInfo entry;
                     entry.pos = posInfo;
                     entry.uncompressed_size = (uLong)fileInfo.uncompressed_size;
+                    entry.crc = fileInfo.crc;
                     data->fileList[currentFileName] = entry;
                 }
             }
@@ -607,4 +609,58 @@ std::vector<std::string> ZipFile::getAllFiles() const
     return res;
 }
 
+unsigned long ZipFile::getFileCRC(const std::string &fileName) const
+{
+    auto it = _data->fileList.find(fileName);
+    if (it == _data->fileList.end())
+    {
+        return 0;
+    }
+    return it->second.crc;
+}
+
+bool ZipFile::readFileChunks(
+    const std::string &fileName,
+    const std::function<bool(const unsigned char*, unsigned long)> &callback
+) {
+    bool ret = false;
+    do
+    {
+        CC_BREAK_IF(!_data->zipFile);
+
+        auto it = _data->fileList.find(fileName);
+        CC_BREAK_IF(it == _data->fileList.end());
+
+        ZipEntryInfo fileInfo = it->second;
+        int nRet = unzGoToFilePos(_data->zipFile, &fileInfo.pos);
+        CC_BREAK_IF(UNZ_OK != nRet);
+
+        nRet = unzOpenCurrentFile(_data->zipFile);
+        CC_BREAK_IF(UNZ_OK != nRet);
+
+        unsigned char buffer[64 * 1024];
+        ret = true;
+        int read;
+        while ((read = unzReadCurrentFile(_data->zipFile, buffer, sizeof(buffer))) > 0)
+        {
+            if (!callback(buffer, (unsigned long)read))
+            {
+                ret = false;
+                break;
+            }
+        }
+        if (read < 0)
+        {
+            ret = false;
+        }
+        // also checks the CRC once the whole file is read
+        if (unzCloseCurrentFile(_data->zipFile) != UNZ_OK)
+        {
+            ret = false;
+        }
+    } while (0);
+
+    return ret;
+}
+
 NS_CC_END
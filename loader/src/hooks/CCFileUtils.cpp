@@ -0,0 +1,34 @@
+#include <ArchiveFS.hpp>
+#include <cstring>
+
+USE_GEODE_NAMESPACE();
+
+#include <Geode/modify/CCFileUtils.hpp>
+class $modify(CCFileUtils) {
+    gd::string fullPathForFilename(const char* filename, bool unk) {
+        if (ArchiveFS::isVirtualPath(filename)) {
+            return filename;
+        }
+        // the game's and Geode's own files come first and texture
+        // packs last, same as when mods' resources were extracted
+        // and added as search paths in between
+        auto path = CCFileUtils::fullPathForFilename(filename, unk);
+        auto& fs = ArchiveFS::get();
+        if (!fs.hasResources()) {
+            return path;
+        }
+        if (std::strcmp(path.c_str(), filename) == 0 || fs.isOverridden(path.c_str())) {
+            if (auto res = fs.resolve(filename)) {
+                return res.value();
+            }
+        }
+        return path;
+    }
+
+    unsigned char* getFileData(const char* filename, const char* mode, unsigned long* size) {
+        if (ArchiveFS::isVirtualPath(filename)) {
+            return ArchiveFS::get().read(filename, size);
+        }
+        return CCFileUtils::getFileData(filename, mode, size);
+    }
+};
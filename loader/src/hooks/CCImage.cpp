@@ -0,0 +1,34 @@
+#include <ArchiveFS.hpp>
+
+USE_GEODE_NAMESPACE();
+
+namespace {
+    bool initFromArchive(CCImage* image, const char* path, CCImage::EImageFormat format) {
+        bool res = false;
+        auto found = ArchiveFS::get().view(path, [&](unsigned char const* data, size_t size) {
+            res = image->initWithImageData(
+                const_cast<unsigned char*>(data), static_cast<int>(size), format, 0, 0, 8
+            );
+        });
+        return found && res;
+    }
+}
+
+#include <Geode/modify/CCImage.hpp>
+class $modify(CCImage) {
+    // images in mounted archives are decoded straight out of the
+    // mapping, instead of getFileData copying them out first
+    bool initWithImageFile(const char* path, EImageFormat format) {
+        if (ArchiveFS::isVirtualPath(path)) {
+            return initFromArchive(this, path, format);
+        }
+        return CCImage::initWithImageFile(path, format);
+    }
+
+    bool initWithImageFileThreadSafe(const char* path, EImageFormat format) {
+        if (ArchiveFS::isVirtualPath(path)) {
+            return initFromArchive(this, path, format);
+        }
+        return CCImage::initWithImageFileThreadSafe(path, format);
+    }
+};
@@ -89,6 +89,10 @@ class $modify(CustomMenuLayer, MenuLayer) {
 	bool init() {
 		if (!MenuLayer::init())
 			return false;
+
+		// the queue only runs from the next frame on, so the menu
+		// shows up before any of these start loading
+		InternalLoader::get()->loadDeferredMods();
 		
 		// set IDs to everything
 		this->setID("main-menu-layer");
@@ -0,0 +1,12 @@
+#include <FrameMonitor.hpp>
+
+USE_GEODE_NAMESPACE();
+
+#include <Geode/modify/CCDirector.hpp>
+class $modify(CCDirector) {
+    void drawScene() {
+        FrameMonitor::get().beginFrame();
+        CCDirector::drawScene();
+        FrameMonitor::get().endFrame();
+    }
+};
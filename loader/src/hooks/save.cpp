@@ -1,4 +1,5 @@
 #include <Geode/loader/Loader.hpp>
+#include <FileWriter.hpp>
 
 USE_GEODE_NAMESPACE();
 
@@ -11,6 +12,12 @@ class $modify(AppDelegate) {
         if (!r) {
             log::log(Severity::Error, Loader::getInternalMod(), "{}", r.error());
         }
+        // this runs when the game is closed or sent to the background,
+        // so don't leave anything waiting on the writer thread, even
+        // if saving stopped early
+        if (auto error = FileWriter::get().flush()) {
+            log::log(Severity::Error, Loader::getInternalMod(), "Unable to save: {}", error.value());
+        }
 
         log::log(Severity::Info, Loader::getInternalMod(), "Saved");
         
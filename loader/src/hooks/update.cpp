@@ -1,4 +1,5 @@
 #include <InternalLoader.hpp>
+#include <Geode/loader/Event.hpp>
 
 USE_GEODE_NAMESPACE();
 
@@ -6,6 +7,7 @@ USE_GEODE_NAMESPACE();
 class $modify(CCScheduler) {
     void update(float dt) {
         InternalLoader::get()->executeGDThreadQueue();
+        Event::processQueued();
         return CCScheduler::update(dt);
     }
 };
@@ -1,5 +1,7 @@
 #include <Geode/loader/Loader.hpp>
 #include <Geode/modify/LoadingLayer.hpp>
+#include <LoadProfiler.hpp>
+#include <FrameMonitor.hpp>
 
 USE_GEODE_NAMESPACE();
 
@@ -9,6 +11,11 @@ class $modify(LoadingLayer) {
 		// this is in case the user refreshes texture quality at runtime
 		if (this->m_loadStep == 10) {
 			Loader::get()->updateResources();
+			// the first time through, startup is done
+			LoadProfiler::get().finish();
+			// loading frames are expected to be slow, so hitches
+			// only count from here on
+			FrameMonitor::get().setBudget(Loader::get()->getFrameBudget());
 		}
 	}
 };
@@ -4,6 +4,7 @@
 #include <Geode/utils/JsonValidation.hpp>
 #include <Geode/utils/fetch.hpp>
 #include <hash.hpp>
+#include <ArchiveFS.hpp>
 #include <Geode/utils/file.hpp>
 #include <Geode/utils/string.hpp>
 #include <Geode/utils/vector.hpp>
@@ -587,7 +588,9 @@ void InstallItems::finish(bool replaceFiles) {
                 }
             }
 
-            // move file
+            // move file; an archive being replaced has to be
+            // unmapped first
+            ArchiveFS::get().unmount(targetFile);
             ghc::filesystem::rename(file, targetFile);
             
         } catch(std::exception& e) {
@@ -0,0 +1,410 @@
+#include "ArchiveFS.hpp"
+#include "InternalMod.hpp"
+#include "ZipDirectory.hpp"
+#include <Geode/loader/Hook.hpp>
+#include <cocos2d.h>
+#include <algorithm>
+
+#ifndef GEODE_IS_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    this->close();
+}
+
+Result<> MappedFile::open(ghc::filesystem::path const& path) {
+    this->close();
+
+#ifdef GEODE_IS_WINDOWS
+    auto file = CreateFileW(
+        path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        return Err("Unable to open file");
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return Err("Unable to map an empty file");
+    }
+    auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        return Err("Unable to map file");
+    }
+    auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    // the view keeps the mapping alive
+    CloseHandle(mapping);
+    if (!view) {
+        return Err("Unable to map file");
+    }
+    m_data = static_cast<unsigned char const*>(view);
+    m_size = static_cast<size_t>(size.QuadPart);
+#else
+    auto fd = ::open(path.string().c_str(), O_RDONLY);
+    if (fd < 0) {
+        return Err("Unable to open file");
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return Err("Unable to map an empty file");
+    }
+    auto view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        return Err("Unable to map file");
+    }
+    m_data = static_cast<unsigned char const*>(view);
+    m_size = static_cast<size_t>(info.st_size);
+#endif
+
+    return Ok();
+}
+
+void MappedFile::close() {
+    if (!m_data) return;
+#ifdef GEODE_IS_WINDOWS
+    UnmapViewOfFile(m_data);
+#else
+    munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+unsigned char const* MappedFile::data() const {
+    return m_data;
+}
+
+size_t MappedFile::size() const {
+    return m_size;
+}
+
+ArchiveFS& ArchiveFS::get() {
+    static auto inst = new ArchiveFS;
+    return *inst;
+}
+
+bool ArchiveFS::isVirtualPath(std::string_view path) {
+    return path.starts_with(PREFIX);
+}
+
+size_t ArchiveFS::Name::size() const {
+    return m_parts[0].size() + m_parts[1].size() + m_parts[2].size();
+}
+
+char ArchiveFS::Name::at(size_t index) const {
+    for (auto& part : m_parts) {
+        if (index < part.size()) {
+            return part[index] == '\\' ? '/' : part[index];
+        }
+        index -= part.size();
+    }
+    return '\0';
+}
+
+std::string ArchiveFS::Name::join() const {
+    std::string res;
+    res.reserve(this->size());
+    for (auto& part : m_parts) {
+        res += part;
+    }
+    std::replace(res.begin(), res.end(), '\\', '/');
+    return res;
+}
+
+size_t ArchiveFS::NameHash::operator()(Name const& name) const {
+    // FNV-1a, over the normalized characters
+    uint64_t hash = 14695981039346656037ull;
+    for (auto& part : name.m_parts) {
+        for (auto c : part) {
+            hash ^= static_cast<unsigned char>(c == '\\' ? '/' : c);
+            hash *= 1099511628211ull;
+        }
+    }
+    return static_cast<size_t>(hash);
+}
+
+bool ArchiveFS::NameEqual::operator()(Name const& a, Name const& b) const {
+    auto size = a.size();
+    if (size != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < size; i++) {
+        if (a.at(i) != b.at(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ArchiveFS::isHooked() {
+    size_t hooked = 0;
+    for (auto hook : InternalMod::get()->getHooks()) {
+        auto name = hook->getDisplayName();
+        if (
+            hook->isEnabled() && (
+                name == "cocos2d::CCFileUtils::fullPathForFilename" ||
+                name == "cocos2d::CCFileUtils::getFileData"
+            )
+        ) {
+            hooked++;
+        }
+    }
+    return hooked == 2;
+}
+
+Result<> ArchiveFS::readDirectory(Archive& archive) {
+    auto data = archive.m_file.data();
+    auto size = archive.m_file.size();
+    std::vector<ZipDirectory::Entry> entries;
+    if (auto err = ZipDirectory::read(data, size, entries)) {
+        return Err(*err);
+    }
+
+    archive.m_entries.reserve(entries.size());
+    for (auto const& entry : entries) {
+        auto& name = entry.m_name;
+        if (!name.starts_with(RESOURCES_DIR) || name.ends_with('/')) {
+            continue;
+        }
+        // anything that can't be read from the mapping means the
+        // extracted copies have to be used for the whole mod
+        if (!entry.isSupported()) {
+            return Err("Zip entry \"" + name + "\" is encrypted or uses an unsupported compression method");
+        }
+        auto offset = ZipDirectory::getDataOffset(data, size, entry);
+        if (!offset) {
+            return Err("Zip entry \"" + name + "\" is corrupted");
+        }
+
+        archive.m_entries.insert({ name.substr(RESOURCES_DIR.size()), Entry {
+            .m_archive = &archive,
+            .m_offset = *offset,
+            .m_compressedSize = entry.m_compressedSize,
+            .m_size = entry.m_size,
+            .m_method = entry.m_method,
+        } });
+    }
+    return Ok();
+}
+
+void ArchiveFS::rebuildIndex() {
+    size_t total = 0;
+    for (auto& archive : m_archives) {
+        total += archive->m_entries.size();
+    }
+    m_index.clear();
+    m_index.reserve(total);
+    for (auto& archive : m_archives) {
+        // doesn't replace files from archives mounted earlier
+        m_index.insert(archive->m_entries.begin(), archive->m_entries.end());
+    }
+}
+
+size_t ArchiveFS::qualityVariants(std::string_view name, Name (&variants)[3]) {
+    auto dot = name.rfind('.');
+    auto slash = name.find_last_of("/\\");
+    if (dot == std::string_view::npos || (slash != std::string_view::npos && dot < slash)) {
+        dot = name.size();
+    }
+    auto stem = name.substr(0, dot);
+    auto ext = name.substr(dot);
+    if (stem.ends_with("-uhd") || stem.ends_with("-hd")) {
+        variants[0] = Name(name);
+        return 1;
+    }
+
+    size_t count = 0;
+    auto quality = CCDirector::get()->getLoadedTextureQuality();
+    if (quality == kTextureQualityHigh) {
+        variants[count++] = Name(stem, "-uhd", ext);
+    }
+    if (quality == kTextureQualityHigh || quality == kTextureQualityMedium) {
+        variants[count++] = Name(stem, "-hd", ext);
+    }
+    variants[count++] = Name(name);
+    return count;
+}
+
+ArchiveFS::Entry const* ArchiveFS::find(Name const& name) const {
+    auto it = m_index.find(name);
+    return it != m_index.end() ? &it->second : nullptr;
+}
+
+Result<> ArchiveFS::mount(ghc::filesystem::path const& path) {
+    std::error_code ec;
+    auto size = ghc::filesystem::file_size(path, ec);
+    if (ec) return Err("Unable to read archive: " + ec.message());
+    auto modified = static_cast<int64_t>(
+        ghc::filesystem::last_write_time(path, ec).time_since_epoch().count()
+    );
+    if (ec) return Err("Unable to read archive: " + ec.message());
+
+    {
+        std::shared_lock lock(m_mutex);
+        for (auto& archive : m_archives) {
+            if (archive->m_path == path && archive->m_size == size && archive->m_modified == modified) {
+                return Ok();
+            }
+        }
+    }
+
+    // mapping and indexing is done before locking so reads
+    // aren't held up
+    auto archive = std::make_unique<Archive>();
+    archive->m_path = path;
+    archive->m_size = size;
+    archive->m_modified = modified;
+    auto open = archive->m_file.open(path);
+    if (!open) {
+        return Err("Unable to map archive: " + open.error());
+    }
+    auto read = readDirectory(*archive);
+    if (!read) {
+        return Err("Unable to index archive: " + read.error());
+    }
+
+    std::unique_lock lock(m_mutex);
+    auto it = std::find_if(m_archives.begin(), m_archives.end(), [&](auto const& archive) {
+        return archive->m_path == path;
+    });
+    if (it != m_archives.end()) {
+        // changed since it was mounted
+        *it = std::move(archive);
+        this->rebuildIndex();
+    } else {
+        // new archives go last, so they can just be added
+        m_index.insert(archive->m_entries.begin(), archive->m_entries.end());
+        m_archives.push_back(std::move(archive));
+    }
+    m_hasResources = !m_index.empty();
+    return Ok();
+}
+
+void ArchiveFS::unmount(ghc::filesystem::path const& path) {
+    std::unique_lock lock(m_mutex);
+    auto it = std::find_if(m_archives.begin(), m_archives.end(), [&](auto const& archive) {
+        return archive->m_path == path;
+    });
+    if (it != m_archives.end()) {
+        m_archives.erase(it);
+        this->rebuildIndex();
+        m_hasResources = !m_index.empty();
+    }
+}
+
+bool ArchiveFS::isMounted(ghc::filesystem::path const& path) const {
+    std::shared_lock lock(m_mutex);
+    return std::any_of(m_archives.begin(), m_archives.end(), [&](auto const& archive) {
+        return archive->m_path == path;
+    });
+}
+
+bool ArchiveFS::hasResources() const {
+    return m_hasResources;
+}
+
+void ArchiveFS::setOverriddenPaths(std::vector<ghc::filesystem::path> const& paths) {
+    std::vector<std::string> normalized;
+    for (auto& path : paths) {
+        auto str = path.string();
+        std::replace(str.begin(), str.end(), '\\', '/');
+        if (!str.ends_with('/')) {
+            str += '/';
+        }
+        normalized.push_back(std::move(str));
+    }
+    std::unique_lock lock(m_mutex);
+    m_overriddenPaths = std::move(normalized);
+}
+
+bool ArchiveFS::isOverridden(std::string_view fullPath) const {
+    std::shared_lock lock(m_mutex);
+    return std::any_of(m_overriddenPaths.begin(), m_overriddenPaths.end(), [&](auto const& path) {
+        return path.size() <= fullPath.size() && std::equal(
+            path.begin(), path.end(), fullPath.begin(),
+            [](char a, char b) { return a == (b == '\\' ? '/' : b); }
+        );
+    });
+}
+
+std::optional<std::string> ArchiveFS::resolve(std::string_view name) const {
+    if (name.starts_with("./") || name.starts_with(".\\")) {
+        name.remove_prefix(2);
+    }
+
+    std::shared_lock lock(m_mutex);
+    if (m_index.empty()) {
+        return std::nullopt;
+    }
+    Name variants[3];
+    auto count = qualityVariants(name, variants);
+    for (size_t i = 0; i < count; i++) {
+        if (this->find(variants[i])) {
+            return std::string(PREFIX) + variants[i].join();
+        }
+    }
+    return std::nullopt;
+}
+
+unsigned char* ArchiveFS::read(std::string_view path, unsigned long* size) const {
+    if (size) *size = 0;
+    if (!isVirtualPath(path)) {
+        return nullptr;
+    }
+
+    // the lock is held while reading so the archive can't be
+    // unmapped from under it
+    std::shared_lock lock(m_mutex);
+    auto entry = this->find(path.substr(PREFIX.size()));
+    if (!entry) {
+        return nullptr;
+    }
+    auto src = entry->m_archive->m_file.data() + entry->m_offset;
+    // cocos frees what it's given so even stored files have
+    // to be copied out of the mapping
+    auto buffer = new unsigned char[entry->m_size ? entry->m_size : 1];
+    if (!ZipDirectory::extract(
+        src, entry->m_method, entry->m_compressedSize, entry->m_size, buffer
+    )) {
+        delete[] buffer;
+        return nullptr;
+    }
+
+    if (size) *size = entry->m_size;
+    return buffer;
+}
+
+bool ArchiveFS::view(
+    std::string_view path, std::function<void(unsigned char const*, size_t)> const& func
+) const {
+    if (!isVirtualPath(path)) {
+        return false;
+    }
+
+    std::shared_lock lock(m_mutex);
+    auto entry = this->find(path.substr(PREFIX.size()));
+    if (!entry) {
+        return false;
+    }
+    auto src = entry->m_archive->m_file.data() + entry->m_offset;
+    if (entry->m_method == ZipDirectory::METHOD_STORED) {
+        func(src, entry->m_size);
+        return true;
+    }
+    auto buffer = std::make_unique<unsigned char[]>(entry->m_size ? entry->m_size : 1);
+    if (!ZipDirectory::extract(
+        src, entry->m_method, entry->m_compressedSize, entry->m_size, buffer.get()
+    )) {
+        return false;
+    }
+    func(buffer.get(), entry->m_size);
+    return true;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <Geode/DefaultInclude.hpp>
+#include <Geode/utils/Result.hpp>
+#include <fs/filesystem.hpp>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+USE_GEODE_NAMESPACE();
+
+/**
+ * Read-only view of a file mapped into memory
+ */
+class MappedFile {
+protected:
+	unsigned char const* m_data = nullptr;
+	size_t m_size = 0;
+
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+
+	Result<> open(ghc::filesystem::path const& path);
+	void close();
+
+	unsigned char const* data() const;
+	size_t size() const;
+};
+
+/**
+ * Serves mods' resources straight out of their .geode archives,
+ * without going through the extracted copies in the temp dir.
+ * Archives are mapped into memory and indexed when mounted, and
+ * files in them are found through virtual paths that the
+ * CCFileUtils hooks resolve and read. Safe to read from several
+ * threads
+ */
+class ArchiveFS {
+public:
+	/**
+	 * Paths starting with this are served from archives
+	 */
+	static constexpr std::string_view PREFIX = "geode.vfs/";
+	/**
+	 * Directory in archives that gets mounted
+	 */
+	static constexpr std::string_view RESOURCES_DIR = "resources/";
+
+protected:
+	struct Archive;
+
+	struct Entry {
+		Archive* m_archive;
+		size_t m_offset;
+		uint32_t m_compressedSize;
+		uint32_t m_size;
+		uint16_t m_method;
+	};
+
+	struct Archive {
+		ghc::filesystem::path m_path;
+		uintmax_t m_size;
+		int64_t m_modified;
+		MappedFile m_file;
+		std::unordered_map<std::string, Entry> m_entries;
+	};
+
+	/**
+	 * A file name made of up to three pieces, so names like
+	 * "stem" + "-hd" + ".png" can be looked up without joining
+	 * them. Backslashes count as forward slashes
+	 */
+	struct Name {
+		std::string_view m_parts[3];
+
+		Name() = default;
+		Name(std::string_view name) : m_parts{ name } {}
+		Name(std::string const& name) : m_parts{ name } {}
+		Name(std::string_view a, std::string_view b, std::string_view c)
+		  : m_parts{ a, b, c } {}
+
+		size_t size() const;
+		char at(size_t index) const;
+		std::string join() const;
+	};
+
+	struct NameHash {
+		using is_transparent = void;
+		size_t operator()(Name const& name) const;
+	};
+
+	struct NameEqual {
+		using is_transparent = void;
+		bool operator()(Name const& a, Name const& b) const;
+	};
+
+	mutable std::shared_mutex m_mutex;
+	// in the order they were mounted; earlier archives win
+	std::vector<std::unique_ptr<Archive>> m_archives;
+	std::unordered_map<std::string, Entry, NameHash, NameEqual> m_index;
+	// so the hooks can skip locking when there's nothing to find
+	std::atomic<bool> m_hasResources = false;
+	// normalized, with a trailing slash
+	std::vector<std::string> m_overriddenPaths;
+
+	ArchiveFS() = default;
+
+	static Result<> readDirectory(Archive& archive);
+	/**
+	 * Names to try for a file, best texture quality first, the
+	 * same way CCFileUtils picks -uhd and -hd variants
+	 * @returns How many of the variants were filled in
+	 */
+	static size_t qualityVariants(std::string_view name, Name (&variants)[3]);
+	/**
+	 * Must hold m_mutex exclusively
+	 */
+	void rebuildIndex();
+	/**
+	 * Must hold m_mutex
+	 */
+	Entry const* find(Name const& name) const;
+
+public:
+	static ArchiveFS& get();
+
+	static bool isVirtualPath(std::string_view path);
+
+	/**
+	 * Whether the CCFileUtils hooks are in place, so mounted
+	 * archives can actually be read from. If not, the extracted
+	 * resources have to be used instead
+	 */
+	static bool isHooked();
+
+	/**
+	 * Map an archive and index its resources. Does nothing if it's
+	 * already mounted and hasn't changed since
+	 */
+	Result<> mount(ghc::filesystem::path const& archive);
+	/**
+	 * Unmap an archive so it can be replaced or deleted. Data read
+	 * from it stays valid
+	 */
+	void unmount(ghc::filesystem::path const& archive);
+	bool isMounted(ghc::filesystem::path const& archive) const;
+	/**
+	 * Whether any mounted archive has resources. Doesn't lock
+	 */
+	bool hasResources() const;
+
+	/**
+	 * Set the search paths that mounted archives take precedence
+	 * over. Mods' resources used to be search paths themselves,
+	 * added before texture paths, and this keeps that order
+	 */
+	void setOverriddenPaths(std::vector<ghc::filesystem::path> const& paths);
+	/**
+	 * Whether a full path CCFileUtils found is in one of the
+	 * overridden search paths
+	 */
+	bool isOverridden(std::string_view fullPath) const;
+
+	/**
+	 * Get the virtual path of a resource, picking the variant for
+	 * the current texture quality like CCFileUtils does
+	 */
+	std::optional<std::string> resolve(std::string_view name) const;
+	/**
+	 * Read a file by its virtual path into a buffer allocated with
+	 * new[], like CCFileUtils::getFileData. Returns null if there
+	 * is no such file
+	 */
+	unsigned char* read(std::string_view path, unsigned long* size) const;
+	/**
+	 * Call a function with the contents of a file by its virtual
+	 * path. Files stored without compression are passed straight
+	 * out of the mapping; the data is only valid during the call,
+	 * and the archive can't be unmounted until it returns
+	 * @returns False if there is no such file or it can't be read
+	 */
+	bool view(
+		std::string_view path, std::function<void(unsigned char const*, size_t)> const& func
+	) const;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+/**
+ * Binary log format, shared by the loader's log writer and the
+ * geode-logdump tool. Kept free of Geode headers so the tool can
+ * be built on its own.
+ *
+ * A file starts with MAGIC and a u32 VERSION, followed by entries
+ * that each start with a u8 Tag. Format strings and mod IDs are
+ * defined once, right before the first record using them, so a
+ * file cut short by a crash is still readable up to its last
+ * complete entry. Integers are little-endian.
+ *
+ *  Format / Mod: u32 id, u32 size, bytes
+ *  Record:       i64 unix time in ns, u32 mod id, u8 severity,
+ *                u32 format id, u8 argument count, u32 size,
+ *                then the arguments as they were logged, encoded
+ *                like geode::log::LogRecord stores them
+ *
+ * Version 1 records instead had a u16 argument count followed by
+ * each argument's text as u32 size, bytes.
+ */
+namespace binlog {
+	constexpr char MAGIC[8] = { 'G', 'E', 'O', 'D', 'E', 'L', 'O', 'G' };
+	constexpr uint32_t VERSION = 2;
+
+	enum class Tag : uint8_t {
+		Format = 1,
+		Mod = 2,
+		Record = 3,
+	};
+
+	/**
+	 * Severity names, in the same order as geode::Severity
+	 */
+	constexpr const char* SEVERITY_NAMES[] = {
+		"Debug", "Info", "Notice", "Warning",
+		"Error", "Critical", "Alert", "Emergency",
+	};
+
+	template <class T>
+	void put(std::string& out, T value) {
+		char bytes[sizeof(T)];
+		std::memcpy(bytes, &value, sizeof(T));
+		out.append(bytes, sizeof(T));
+	}
+
+	inline void putString(std::string& out, std::string_view str) {
+		put<uint32_t>(out, static_cast<uint32_t>(str.size()));
+		out.append(str.data(), str.size());
+	}
+
+	/**
+	 * Reads entries out of a binary log held in memory. Every
+	 * read fails instead of running past the end
+	 */
+	class Reader {
+		std::string_view m_data;
+		size_t m_offset = 0;
+
+	public:
+		Reader(std::string_view data) : m_data(data) {}
+
+		bool done() const {
+			return m_offset >= m_data.size();
+		}
+
+		template <class T>
+		bool get(T& value) {
+			if (m_data.size() - m_offset < sizeof(T)) return false;
+			std::memcpy(&value, m_data.data() + m_offset, sizeof(T));
+			m_offset += sizeof(T);
+			return true;
+		}
+
+		bool getBytes(std::string_view& bytes, size_t size) {
+			if (m_data.size() - m_offset < size) return false;
+			bytes = m_data.substr(m_offset, size);
+			m_offset += size;
+			return true;
+		}
+
+		bool getString(std::string_view& str) {
+			uint32_t size;
+			return this->get(size) && this->getBytes(str, size);
+		}
+
+		/**
+		 * @returns The file's version, or 0 if it's not a
+		 * binary log or is newer than VERSION
+		 */
+		uint32_t getHeader() {
+			if (m_data.size() < sizeof(MAGIC)) return 0;
+			if (std::memcmp(m_data.data(), MAGIC, sizeof(MAGIC)) != 0) return 0;
+			m_offset = sizeof(MAGIC);
+			uint32_t version;
+			if (!this->get(version) || version > VERSION) return 0;
+			return version;
+		}
+
+	};
+}
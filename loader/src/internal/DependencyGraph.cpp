@@ -0,0 +1,86 @@
+#include "DependencyGraph.hpp"
+#include <algorithm>
+#include <unordered_map>
+
+std::vector<std::vector<size_t>> DependencyGraph::sortIntoLayers(
+    std::vector<Node> const& nodes, std::vector<size_t>& cyclic
+) {
+    std::unordered_map<std::string_view, size_t> indices;
+    indices.reserve(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        indices.insert({ nodes[i].m_id, i });
+    }
+
+    struct State {
+        // nodes that depend on this one, and whether they need it
+        std::vector<std::pair<size_t, bool>> m_dependents;
+        size_t m_waitingOn = 0;
+        size_t m_requiredWaitingOn = 0;
+        bool m_done = false;
+    };
+    std::vector<State> states(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        for (auto const& [id, required] : nodes[i].m_dependencies) {
+            auto it = indices.find(id);
+            if (it == indices.end() || it->second == i) continue;
+            states[it->second].m_dependents.push_back({ i, required });
+            states[i].m_waitingOn++;
+            if (required) {
+                states[i].m_requiredWaitingOn++;
+            }
+        }
+    }
+
+    std::vector<std::vector<size_t>> layers;
+    std::vector<size_t> current;
+    for (size_t i = 0; i < states.size(); i++) {
+        if (!states[i].m_waitingOn) {
+            current.push_back(i);
+        }
+    }
+    size_t doneCount = 0;
+    while (doneCount < states.size()) {
+        if (current.empty()) {
+            // only cycles are left. If some of them are only held
+            // together by optional dependencies, one of their nodes
+            // is let through in a layer of its own, since it may
+            // load before the mods it optionally depends on but
+            // not alongside them
+            for (size_t i = 0; i < states.size(); i++) {
+                if (!states[i].m_done && !states[i].m_requiredWaitingOn) {
+                    current.push_back(i);
+                    break;
+                }
+            }
+            if (current.empty()) break;
+        }
+        std::sort(current.begin(), current.end());
+        for (auto i : current) {
+            states[i].m_done = true;
+        }
+        doneCount += current.size();
+
+        std::vector<size_t> next;
+        for (auto i : current) {
+            for (auto [dependent, required] : states[i].m_dependents) {
+                auto& state = states[dependent];
+                state.m_waitingOn--;
+                if (required) {
+                    state.m_requiredWaitingOn--;
+                }
+                if (!state.m_done && !state.m_waitingOn) {
+                    next.push_back(dependent);
+                }
+            }
+        }
+        layers.push_back(std::move(current));
+        current = std::move(next);
+    }
+
+    for (size_t i = 0; i < states.size(); i++) {
+        if (!states[i].m_done) {
+            cyclic.push_back(i);
+        }
+    }
+    return layers;
+}
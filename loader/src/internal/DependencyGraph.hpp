@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * Orders mods by their dependencies. Only knows about IDs, so it
+ * doesn't need the rest of the loader and can be used by tools
+ * like geode-bench
+ */
+class DependencyGraph {
+public:
+	struct Node {
+		std::string_view m_id;
+		/**
+		 * IDs of the mods this one depends on, and whether
+		 * each is required
+		 */
+		std::vector<std::pair<std::string_view, bool>> m_dependencies;
+	};
+
+	/**
+	 * Sort nodes into layers where each node only depends on nodes
+	 * in earlier layers, so nodes in the same layer can be loaded
+	 * at the same time. Dependencies on IDs that aren't in the
+	 * graph are ignored. Optional dependencies are put first unless
+	 * they form a cycle, which is broken by putting one of its
+	 * nodes in a layer of its own. Within a layer, nodes keep the
+	 * order they were given in
+	 * @param cyclic Filled with the indices of the nodes stuck in
+	 * a cycle of required dependencies, or depending on one
+	 * @returns Indices into nodes, layer by layer
+	 */
+	static std::vector<std::vector<size_t>> sortIntoLayers(
+		std::vector<Node> const& nodes, std::vector<size_t>& cyclic
+	);
+};
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Event handlers bucketed by the exact event type they listen to,
+ * and the order events are dispatched to them in. Event.cpp uses
+ * it with BasicEventHandler and Event; it doesn't depend on the
+ * rest of the loader, so geode-bench can time dispatch with its
+ * own handler types. Not thread-safe; only used on the GD thread
+ */
+template <class Handler, class Event>
+class EventRegistry {
+public:
+	/**
+	 * Checks whether an event can be received by a bucket's handlers
+	 */
+	using Filter = bool(*)(Event*);
+
+	/**
+	 * All handlers listening to one exact event type, sorted
+	 * by descending priority and then by insertion order.
+	 * Removed handlers are left as null tombstones until the
+	 * next compaction so indexes stay valid while dispatching
+	 */
+	struct Bucket {
+		Filter m_filter;
+		std::vector<Handler*> m_handlers;
+		std::vector<int> m_priorities;
+		size_t m_tombstones = 0;
+
+		void insert(Handler* handler) {
+			// insert after every handler with the same or
+			// higher priority to keep the order stable
+			auto priority = handler->getPriority();
+			auto pos = std::upper_bound(
+				m_priorities.begin(), m_priorities.end(),
+				priority, std::greater<int>()
+			) - m_priorities.begin();
+			m_handlers.insert(m_handlers.begin() + pos, handler);
+			m_priorities.insert(m_priorities.begin() + pos, priority);
+		}
+
+		bool bury(Handler* handler) {
+			for (auto& h : m_handlers) {
+				if (h == handler) {
+					h = nullptr;
+					m_tombstones += 1;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void compact() {
+			if (!m_tombstones) return;
+			size_t to = 0;
+			for (size_t from = 0; from < m_handlers.size(); from++) {
+				if (m_handlers[from]) {
+					m_handlers[to] = m_handlers[from];
+					m_priorities[to] = m_priorities[from];
+					to += 1;
+				}
+			}
+			m_handlers.resize(to);
+			m_priorities.resize(to);
+			m_tombstones = 0;
+		}
+	};
+
+	/**
+	 * Buckets that accept a specific dynamic event type.
+	 * Buckets created after the route was last checked
+	 * are tested the next time the event type is posted
+	 */
+	struct Route {
+		size_t m_checkedBuckets = 0;
+		std::vector<Bucket*> m_buckets;
+	};
+
+protected:
+	std::unordered_map<std::type_index, Bucket*> m_bucketsByType;
+	std::vector<Bucket*> m_buckets;
+	std::unordered_map<std::type_index, Route> m_routes;
+	// every handler that is listening, including pending ones
+	std::unordered_set<Handler*> m_handlers;
+	// handlers that started listening during a dispatch
+	std::vector<std::pair<Bucket*, Handler*>> m_pending;
+	size_t m_dispatchDepth = 0;
+	bool m_needsCompaction = false;
+
+	Route& getRoute(Event* ev) {
+		auto& route = m_routes[typeid(*ev)];
+		for (; route.m_checkedBuckets < m_buckets.size(); route.m_checkedBuckets++) {
+			auto bucket = m_buckets[route.m_checkedBuckets];
+			if (bucket->m_filter(ev)) {
+				route.m_buckets.push_back(bucket);
+			}
+		}
+		return route;
+	}
+
+	void endDispatch() {
+		m_dispatchDepth -= 1;
+		if (m_dispatchDepth) return;
+
+		if (m_needsCompaction) {
+			for (auto& bucket : m_buckets) {
+				bucket->compact();
+			}
+			m_needsCompaction = false;
+		}
+		for (auto& [bucket, handler] : m_pending) {
+			bucket->insert(handler);
+		}
+		m_pending.clear();
+	}
+
+	struct DispatchScope {
+		EventRegistry* m_registry;
+
+		DispatchScope(EventRegistry* registry) : m_registry(registry) {
+			m_registry->m_dispatchDepth += 1;
+		}
+		~DispatchScope() {
+			m_registry->endDispatch();
+		}
+	};
+
+public:
+	Bucket* getBucket(std::type_info const& type) {
+		auto it = m_bucketsByType.find(type);
+		if (it != m_bucketsByType.end()) {
+			return it->second;
+		}
+		return nullptr;
+	}
+
+	Bucket* getOrCreateBucket(std::type_info const& type, Filter filter) {
+		if (auto bucket = this->getBucket(type)) {
+			return bucket;
+		}
+		auto bucket = new Bucket;
+		bucket->m_filter = filter;
+		m_bucketsByType.insert({ type, bucket });
+		m_buckets.push_back(bucket);
+		return bucket;
+	}
+
+	std::unordered_set<Handler*> const& getHandlers() const {
+		return m_handlers;
+	}
+
+	void add(Bucket* bucket, Handler* handler) {
+		m_handlers.insert(handler);
+		if (m_dispatchDepth) {
+			m_pending.push_back({ bucket, handler });
+		} else {
+			bucket->insert(handler);
+		}
+	}
+
+	void remove(Bucket* bucket, Handler* handler) {
+		m_handlers.erase(handler);
+		for (auto it = m_pending.begin(); it != m_pending.end(); it++) {
+			if (it->second == handler) {
+				m_pending.erase(it);
+				return;
+			}
+		}
+		if (bucket->bury(handler)) {
+			if (m_dispatchDepth) {
+				m_needsCompaction = true;
+			} else {
+				bucket->compact();
+			}
+		}
+	}
+
+	/**
+	 * Call a function with each handler that accepts an event, in
+	 * priority order, until it returns true. Handler arrays are not
+	 * reshaped until the outermost dispatch finishes, so plain
+	 * indexes stay valid even if handlers listen, unlisten or post
+	 * events themselves
+	 */
+	template <class F>
+	void dispatch(Event* ev, F&& call) {
+		DispatchScope scope(this);
+		auto& route = this->getRoute(ev);
+
+		if (route.m_buckets.size() == 1) {
+			auto& handlers = route.m_buckets.front()->m_handlers;
+			for (size_t i = 0; i < handlers.size(); i++) {
+				if (handlers[i] && call(handlers[i])) {
+					return;
+				}
+			}
+			return;
+		}
+
+		// event is accepted by handlers of multiple types (i.e.
+		// some listen to a base class), so merge the buckets by
+		// priority; ties go to the bucket that was created first.
+		// The route may grow if a handler posts an event of the
+		// same type, so only the buckets known now are visited
+		auto bucketCount = route.m_buckets.size();
+		std::vector<size_t> cursors(bucketCount, 0);
+		while (true) {
+			Bucket* next = nullptr;
+			size_t* nextCursor = nullptr;
+			for (size_t b = 0; b < bucketCount; b++) {
+				auto bucket = route.m_buckets[b];
+				if (cursors[b] >= bucket->m_handlers.size()) continue;
+				if (!next || bucket->m_priorities[cursors[b]] > next->m_priorities[*nextCursor]) {
+					next = bucket;
+					nextCursor = &cursors[b];
+				}
+			}
+			if (!next) break;
+			auto handler = next->m_handlers[(*nextCursor)++];
+			if (handler && call(handler)) {
+				return;
+			}
+		}
+	}
+};
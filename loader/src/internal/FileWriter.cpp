@@ -0,0 +1,268 @@
+#include "FileWriter.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#if _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    /**
+     * Write a whole file and sync it to disk before returning
+     */
+    bool writeSynced(ghc::filesystem::path const& path, std::string const& data) {
+        #if _WIN32
+        auto fd = _wopen(
+            path.wstring().c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+            _S_IREAD | _S_IWRITE
+        );
+        if (fd < 0) return false;
+        bool ok = true;
+        for (size_t written = 0; ok && written < data.size();) {
+            auto chunk = std::min<size_t>(data.size() - written, 1 << 30);
+            auto res = _write(fd, data.data() + written, static_cast<unsigned>(chunk));
+            ok = res > 0;
+            written += ok ? res : 0;
+        }
+        ok = ok && _commit(fd) == 0;
+        return _close(fd) == 0 && ok;
+        #else
+        auto fd = ::open(path.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+        bool ok = true;
+        for (size_t written = 0; ok && written < data.size();) {
+            auto res = ::write(fd, data.data() + written, data.size() - written);
+            if (res < 0 && errno == EINTR) continue;
+            ok = res > 0;
+            written += ok ? res : 0;
+        }
+        ok = ok && ::fsync(fd) == 0;
+        return ::close(fd) == 0 && ok;
+        #endif
+    }
+
+    /**
+     * Make a rename in a directory survive power loss. Windows
+     * has no equivalent, and NTFS journals renames anyway
+     */
+    void syncDirectory(ghc::filesystem::path const& dir) {
+        #if !_WIN32
+        auto fd = ::open(dir.empty() ? "." : dir.string().c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        ::fsync(fd);
+        ::close(fd);
+        #endif
+    }
+}
+
+FileWriter& FileWriter::get() {
+    static auto inst = new FileWriter;
+    return *inst;
+}
+
+void FileWriter::setErrorHandler(ErrorHandler handler) {
+    std::lock_guard lock(m_mutex);
+    m_onError = std::move(handler);
+}
+
+void FileWriter::write(ghc::filesystem::path const& path, std::string data) {
+    auto now = Clock::now();
+    {
+        std::lock_guard lock(m_mutex);
+        auto it = m_pending.find(path.string());
+        if (it != m_pending.end()) {
+            it->second.m_data = std::move(data);
+            it->second.m_last = now;
+        } else {
+            m_pending.insert({ path.string(), Pending { path, std::move(data), now, now } });
+        }
+        if (!m_running && !m_stopped) {
+            m_running = true;
+            m_thread = std::thread([this] { this->threadMain(); });
+
+            static bool registeredExit = false;
+            if (!registeredExit) {
+                registeredExit = true;
+                std::atexit(+[] { FileWriter::get().flushOnExit(); });
+            }
+        }
+    }
+    m_wake.notify_one();
+}
+
+void FileWriter::threadMain() {
+    std::unique_lock lock(m_mutex);
+    while (m_running) {
+        if (m_pending.empty()) {
+            m_wake.wait(lock);
+            continue;
+        }
+        // sleep until the first file is due, or until something
+        // else is queued
+        auto due = Clock::time_point::max();
+        for (auto const& [_, pending] : m_pending) {
+            due = std::min({ due, pending.m_last + DEBOUNCE, pending.m_first + MAX_DELAY });
+        }
+        if (Clock::now() < due) {
+            m_wake.wait_until(lock, due);
+            continue;
+        }
+        auto onError = m_onError;
+        lock.unlock();
+        for (auto const& error : this->writeDue(false)) {
+            if (onError) onError(error);
+        }
+        lock.lock();
+    }
+}
+
+std::vector<FileWriter::Pending> FileWriter::takeDue(bool all) {
+    std::vector<Pending> files;
+    auto now = Clock::now();
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        auto const& pending = it->second;
+        if (all || now >= pending.m_last + DEBOUNCE || now >= pending.m_first + MAX_DELAY) {
+            files.push_back(std::move(it->second));
+            it = m_pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return files;
+}
+
+std::vector<std::string> FileWriter::writeFiles(
+    std::vector<Pending>& files, std::vector<Pending>& failed
+) {
+    std::vector<std::string> errors;
+    for (auto& file : files) {
+        auto key = file.m_path.string();
+        auto it = m_written.find(key);
+        if (it != m_written.end() && it->second == file.m_data) {
+            continue;
+        }
+        if (auto error = writeAtomic(file.m_path, file.m_data)) {
+            m_written.erase(key);
+            errors.push_back(std::move(error.value()));
+            failed.push_back(std::move(file));
+        } else {
+            m_written[key] = std::move(file.m_data);
+        }
+    }
+    return errors;
+}
+
+void FileWriter::requeue(std::vector<Pending>& failed) {
+    // pushed into the future so a file that can't be written
+    // isn't retried over and over
+    auto retry = Clock::now() + RETRY_DELAY;
+    for (auto& file : failed) {
+        file.m_first = file.m_last = retry;
+        m_pending.insert({ file.m_path.string(), std::move(file) });
+    }
+}
+
+std::vector<std::string> FileWriter::writeDue(bool all) {
+    std::lock_guard writeLock(m_writeMutex);
+
+    std::vector<Pending> files;
+    {
+        std::lock_guard lock(m_mutex);
+        files = this->takeDue(all);
+    }
+    std::vector<Pending> failed;
+    auto errors = this->writeFiles(files, failed);
+    if (failed.size()) {
+        std::lock_guard lock(m_mutex);
+        this->requeue(failed);
+    }
+    m_wake.notify_one();
+    return errors;
+}
+
+std::optional<std::string> FileWriter::flush() {
+    auto errors = this->writeDue(true);
+    if (errors.empty()) {
+        return std::nullopt;
+    }
+    auto message = errors.front();
+    for (size_t i = 1; i < errors.size(); i++) {
+        message += "; " + errors[i];
+    }
+    return message;
+}
+
+void FileWriter::stop() {
+    ErrorHandler onError;
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopped = true;
+        m_running = false;
+        onError = m_onError;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    for (auto const& error : this->writeDue(true)) {
+        if (onError) onError(error);
+    }
+}
+
+void FileWriter::flushOnExit() {
+    // gives up on a lock after a while instead of deadlocking;
+    // the thread holding it is either dead or stuck
+    auto deadline = Clock::now() + EXIT_WAIT;
+    auto lockBefore = [&](std::mutex& mutex) {
+        while (!mutex.try_lock()) {
+            if (Clock::now() >= deadline) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    };
+
+    auto haveWriteLock = lockBefore(m_writeMutex);
+    auto haveLock = lockBefore(m_mutex);
+    m_stopped = true;
+    m_running = false;
+    auto files = this->takeDue(true);
+    auto onError = m_onError;
+    if (haveLock) m_mutex.unlock();
+
+    std::vector<Pending> failed;
+    for (auto const& error : this->writeFiles(files, failed)) {
+        if (onError) onError(error);
+    }
+    if (haveWriteLock) m_writeMutex.unlock();
+}
+
+std::optional<std::string> FileWriter::writeAtomic(
+    ghc::filesystem::path const& path, std::string const& data
+) {
+    auto temp = path;
+    temp += ".tmp";
+    // synced before the rename, so the rename can't reach the
+    // disk before the data does
+    if (!writeSynced(temp, data)) {
+        std::error_code ec;
+        ghc::filesystem::remove(temp, ec);
+        return "Unable to write " + temp.string();
+    }
+    // replaces the old file in one step, so it's either entirely
+    // the old or entirely the new content
+    std::error_code ec;
+    ghc::filesystem::rename(temp, path, ec);
+    if (ec) {
+        ghc::filesystem::remove(temp, ec);
+        return "Unable to replace " + path.string();
+    }
+    syncDirectory(path.parent_path());
+    return std::nullopt;
+}
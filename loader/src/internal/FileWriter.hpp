@@ -0,0 +1,135 @@
+#pragma once
+
+#include <fs/filesystem.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Writes save files on a background thread. Writes to a file that
+ * come in quick succession are merged into one, content identical
+ * to what was last written is skipped, and every file is written
+ * and synced to a temporary file that's then renamed over the old
+ * one, so a crash or power loss halfway through a write never
+ * corrupts it. Doesn't depend on the rest of the loader, so
+ * geode-bench can time it
+ */
+class FileWriter {
+public:
+	using ErrorHandler = std::function<void(std::string const&)>;
+
+	/**
+	 * How long a file has to go without changes before it's written
+	 */
+	static constexpr auto DEBOUNCE = std::chrono::milliseconds(250);
+	/**
+	 * Longest a file is held back while it keeps changing
+	 */
+	static constexpr auto MAX_DELAY = std::chrono::seconds(2);
+	/**
+	 * How long a file that couldn't be written waits before it's
+	 * tried again
+	 */
+	static constexpr auto RETRY_DELAY = std::chrono::seconds(5);
+	/**
+	 * Longest the exit flush waits for locks the writer thread may
+	 * hold; on Windows it may already have been killed holding them
+	 */
+	static constexpr auto EXIT_WAIT = std::chrono::seconds(2);
+
+protected:
+	using Clock = std::chrono::steady_clock;
+
+	struct Pending {
+		ghc::filesystem::path m_path;
+		std::string m_data;
+		Clock::time_point m_first;
+		Clock::time_point m_last;
+	};
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::unordered_map<std::string, Pending> m_pending;
+	ErrorHandler m_onError;
+	std::thread m_thread;
+	bool m_running = false;
+	bool m_stopped = false;
+
+	// held while writing so a flush can't overtake the thread
+	// with older data for the same file
+	std::mutex m_writeMutex;
+	// what each file was last written with; guarded by
+	// m_writeMutex
+	std::unordered_map<std::string, std::string> m_written;
+
+	FileWriter() = default;
+
+	void threadMain();
+	/**
+	 * Write the files that are due, or all of them. Files that
+	 * couldn't be written are queued again
+	 * @returns Error messages for the files that couldn't be written
+	 */
+	std::vector<std::string> writeDue(bool all);
+	/**
+	 * Must hold m_mutex
+	 */
+	std::vector<Pending> takeDue(bool all);
+	/**
+	 * Must hold m_writeMutex
+	 * @param failed Filled with the files that couldn't be written
+	 * @returns Error messages for them
+	 */
+	std::vector<std::string> writeFiles(std::vector<Pending>& files, std::vector<Pending>& failed);
+	/**
+	 * Queue files that couldn't be written to be tried again,
+	 * unless newer data for them was queued since. Must hold
+	 * m_mutex
+	 */
+	void requeue(std::vector<Pending>& failed);
+	/**
+	 * Write everything that's waiting when the process exits, on
+	 * the exiting thread and without joining the writer thread
+	 */
+	void flushOnExit();
+
+public:
+	static FileWriter& get();
+
+	/**
+	 * Called with an error message when a file can't be written
+	 * in the background or while stopping
+	 */
+	void setErrorHandler(ErrorHandler handler);
+
+	/**
+	 * Queue a file to be written. Replaces any write to the same
+	 * file that's still waiting
+	 */
+	void write(ghc::filesystem::path const& path, std::string data);
+	/**
+	 * Write everything that's waiting on the calling thread
+	 * @returns An error message if any file couldn't be written
+	 */
+	std::optional<std::string> flush();
+	/**
+	 * Flush and stop the background thread. Writes queued after
+	 * this wait for the next flush. Everything waiting is also
+	 * written when the process exits
+	 */
+	void stop();
+
+	/**
+	 * Write a file through a temporary file in the same directory
+	 * @returns An error message on failure
+	 */
+	static std::optional<std::string> writeAtomic(
+		ghc::filesystem::path const& path, std::string const& data
+	);
+};
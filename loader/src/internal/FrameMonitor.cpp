@@ -0,0 +1,83 @@
+#include "FrameMonitor.hpp"
+#include <Geode/loader/Mod.hpp>
+#include <Geode/loader/Trace.hpp>
+#include <fmt/format.h>
+#include <algorithm>
+
+std::string FrameHitch::toString() const {
+    auto res = fmt::format("Frame took {:.1f} ms", m_duration / 1'000'000.0);
+    if (m_culprits.empty()) {
+        return res;
+    }
+    res += ":";
+    for (auto& culprit : m_culprits) {
+        res += fmt::format(
+            " {} ({}{}{}) {:.1f} ms;",
+            culprit.m_name, culprit.m_category,
+            culprit.m_modID.size() ? ", " : "", culprit.m_modID,
+            culprit.m_duration / 1'000'000.0
+        );
+    }
+    res.pop_back();
+    return res;
+}
+
+FrameMonitor& FrameMonitor::get() {
+    static auto inst = new FrameMonitor;
+    return *inst;
+}
+
+void FrameMonitor::setBudget(uint32_t milliseconds) {
+    m_budget = milliseconds * uint64_t(1'000'000);
+    trace::setBackground(m_budget != 0);
+}
+
+void FrameMonitor::beginFrame() {
+    if (!m_budget) return;
+    m_frameStart = trace::now();
+}
+
+void FrameMonitor::endFrame() {
+    if (!m_budget || !m_frameStart) return;
+    auto end = trace::now();
+    auto duration = end - m_frameStart;
+    if (duration <= m_budget) return;
+
+    FrameHitch hitch;
+    hitch.m_time = log::log_clock::now();
+    hitch.m_duration = duration;
+
+    // hooks aren't traced individually, so this is whatever
+    // events, dispatch calls, queued functions and mod-defined
+    // scopes ran on this thread during the frame
+    auto records = trace::getThreadRecords(m_frameStart, end);
+    std::erase_if(records, [](auto const& rec) {
+        return rec.m_phase != trace::Phase::Complete;
+    });
+    auto count = std::min(records.size(), MAX_CULPRITS);
+    std::partial_sort(
+        records.begin(), records.begin() + count, records.end(),
+        [](auto const& a, auto const& b) {
+            return a.m_duration > b.m_duration;
+        }
+    );
+    for (size_t i = 0; i < count; i++) {
+        auto& rec = records[i];
+        hitch.m_culprits.push_back({
+            trace::getName(rec),
+            rec.m_category ? rec.m_category : "",
+            rec.m_modID ? rec.m_modID : "",
+            rec.m_duration,
+        });
+    }
+
+    log::warn("{}", hitch.toString());
+    m_hitches.push_back(std::move(hitch));
+    if (m_hitches.size() > MAX_HITCHES) {
+        m_hitches.pop_front();
+    }
+}
+
+std::deque<FrameHitch> const& FrameMonitor::getHitches() const {
+    return m_hitches;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Geode/loader/Log.hpp>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+USE_GEODE_NAMESPACE();
+
+/**
+ * A frame that went over the frame budget, along with what took
+ * the longest during it
+ */
+struct FrameHitch {
+	struct Culprit {
+		std::string m_name;
+		std::string m_category;
+		/**
+		 * ID of the mod the work was done for, if known. Kept as
+		 * a string since the mod may be unloaded later
+		 */
+		std::string m_modID;
+		uint64_t m_duration;
+	};
+
+	log::log_clock::time_point m_time;
+	uint64_t m_duration;
+	std::vector<Culprit> m_culprits;
+
+	std::string toString() const;
+};
+
+/**
+ * Times every frame and, when one goes over budget, works out
+ * what ran during it from the trace buffers. Tracing is kept on
+ * in the background while the monitor is on
+ */
+class FrameMonitor {
+protected:
+	static constexpr size_t MAX_HITCHES = 32;
+	static constexpr size_t MAX_CULPRITS = 5;
+
+	uint64_t m_budget = 0;
+	uint64_t m_frameStart = 0;
+	std::deque<FrameHitch> m_hitches;
+
+	FrameMonitor() = default;
+
+public:
+	static FrameMonitor& get();
+
+	/**
+	 * @param milliseconds Longest a frame may take before it's
+	 * reported, or 0 to turn the monitor off
+	 */
+	void setBudget(uint32_t milliseconds);
+
+	// only called on the GD thread, around drawing each frame
+
+	void beginFrame();
+	void endFrame();
+
+	/**
+	 * Most recent hitches, oldest first
+	 */
+	std::deque<FrameHitch> const& getHitches() const;
+};
@@ -4,15 +4,49 @@
 #include <sstream>
 #include <iostream>
 #include "InternalMod.hpp"
+#include "LoadProfiler.hpp"
+#include "LogSink.hpp"
+#include "WorkerPool.hpp"
 #include <Geode/loader/Log.hpp>
 #include <Geode/loader/Loader.hpp>
+#include <Geode/loader/Trace.hpp>
 #include <Geode/utils/fetch.hpp>
 #include <thread>
+#include <algorithm>
+#include <atomic>
 #include "resources.hpp"
 #include <hash.hpp>
 #include <Geode/utils/file.hpp>
 
-InternalLoader::InternalLoader() : Loader() {}
+namespace {
+    thread_local InternalLoader::ScheduleCapture* t_scheduleCapture = nullptr;
+
+    Mod* findModOrLoader(std::unordered_map<std::string, Mod*> const& mods, std::string const& id) {
+        auto it = mods.find(id);
+        if (it != mods.end()) {
+            return it->second;
+        }
+        return id == InternalMod::get()->getID() ? InternalMod::get() : nullptr;
+    }
+}
+
+InternalLoader::InternalLoader() : Loader() {
+    LogSink::get().setOutput({
+        .m_onLog = [this](log::LogRecord const& record) {
+            // the message is only put together if someone looks
+            m_logs.push(log::Log(
+                static_cast<Mod*>(record.m_mod), Severity::cast(record.m_severity),
+                record.m_time, record.m_format, std::string(record.getArgs())
+            ));
+        },
+        .m_console = [this](std::string const& lines) {
+            this->logConsoleMessage(lines);
+        },
+        .m_consoleOpen = [this] {
+            return m_platformConsoleOpen;
+        },
+    });
+}
 
 InternalLoader::~InternalLoader() {
     this->closePlatformConsole();
@@ -27,7 +61,12 @@ bool InternalLoader::setup() {
     log::log(Severity::Debug, InternalMod::get(), "Set up internal mod representation");
     log::log(Severity::Debug, InternalMod::get(), "Loading hooks... ");
 
-    if (!this->loadHooks()) {
+    bool hooksLoaded;
+    {
+        LoadPhase phase("InternalLoader::loadHooks");
+        hooksLoaded = this->loadHooks();
+    }
+    if (!hooksLoaded) {
         log::log(
             Severity::Error,
             InternalMod::get(),
@@ -41,28 +80,197 @@ bool InternalLoader::setup() {
 }
 
 void InternalLoader::queueInGDThread(ScheduledFunction func) {
-    std::lock_guard<std::mutex> lock(m_gdThreadMutex);
-    m_gdThreadQueue.push_back(func);
+    this->queueInGDThread(std::move(func), nullptr);
+}
+
+void InternalLoader::queueInGDThread(ScheduledFunction func, void const* key) {
+    auto task = new GDThreadTask;
+    task->m_func = std::move(func);
+    task->m_key = key;
+    m_gdThreadQueue.push(task);
+}
+
+InternalLoader::ScheduleCapture* InternalLoader::getScheduleCapture() {
+    return t_scheduleCapture;
+}
+
+void InternalLoader::loadBinariesAhead(std::vector<Mod*> const& mods) {
+    // only mods that are certain to load right after; the
+    // checks match Mod::updateDependencyStates
+    std::vector<Mod*> loading;
+    for (auto mod : mods) {
+        if (!mod->m_enabled || mod->m_loaded || mod->m_resolved || mod->m_platformInfo) {
+            continue;
+        }
+        auto ready = std::all_of(
+            mod->m_info.m_dependencies.begin(), mod->m_info.m_dependencies.end(),
+            [this](Dependency const& dep) {
+                if (!dep.m_required) return true;
+                auto depMod = this->getLoadedMod(dep.m_id);
+                return depMod && !depMod->hasUnresolvedDependencies() && depMod->isEnabled();
+            }
+        );
+        if (ready) {
+            loading.push_back(mod);
+        }
+    }
+    // a single binary is just as well loaded by Mod::load
+    if (loading.size() < 2) return;
+
+    LoadPhase phase("InternalLoader::loadBinariesAhead");
+    std::vector<ScheduleCapture*> captures;
+    for (auto mod : loading) {
+        captures.push_back(&m_scheduleCaptures[mod]);
+    }
+
+    WorkerPool::get().forEach(loading.size(), [&](size_t i) {
+        auto mod = loading[i];
+        // failures are left for Mod::load to retry and report
+        if (mod->m_tempDirName.empty()) {
+            LoadPhase tempDirPhase("Mod::createTempDir", mod);
+            if (!mod->createTempDir()) return;
+        }
+        LoadPhase binaryPhase("Mod::loadPlatformBinary", mod);
+        t_scheduleCapture = captures[i];
+        auto res = mod->loadPlatformBinary();
+        t_scheduleCapture = nullptr;
+        if (!res) {
+            // anything captured points into a binary that
+            // didn't load
+            *captures[i] = ScheduleCapture();
+        }
+    });
+}
+
+void InternalLoader::releaseScheduleCapture(Mod* mod) {
+    auto it = m_scheduleCaptures.find(mod);
+    if (it == m_scheduleCaptures.end()) return;
+    for (auto& func : it->second.m_logs) {
+        log::Log::schedule(func);
+    }
+    for (auto& func : it->second.m_functions) {
+        m_scheduledFunctions.push_back(func);
+    }
+    m_scheduleCaptures.erase(it);
+}
+
+void InternalLoader::discardBinariesAhead() {
+    for (auto& [mod, _] : m_scheduleCaptures) {
+        if (!mod->m_loaded && mod->m_platformInfo) {
+            (void)mod->unloadPlatformBinary();
+        }
+    }
+    m_scheduleCaptures.clear();
+}
+
+void InternalLoader::loadDeferredMods() {
+    if (!m_deferringMods) return;
+    m_deferringMods = false;
+
+    std::vector<Mod*> cyclic;
+    size_t count = 0;
+    for (auto const& layer : this->getDependencyLayers(cyclic)) {
+        for (auto mod : layer) {
+            if (!mod->m_deferred) continue;
+            count++;
+            // the mod may be gone by the time this runs
+            this->queueInGDThread([this, id = mod->m_info.m_id] {
+                auto it = m_mods.find(id);
+                if (it == m_mods.end() || !it->second->m_deferred) return;
+                auto mod = it->second;
+                LoadPhase phase("InternalLoader::loadDeferredMod", mod);
+                mod->m_deferred = false;
+                mod->updateDependencyStates();
+            });
+        }
+    }
+    if (count) {
+        log::debug("Loading {} deferred mods", count);
+    }
+}
+
+void InternalLoader::queueModSave(Mod* mod) {
+    {
+        std::lock_guard lock(m_modsToSaveMutex);
+        m_modsToSave.insert(mod->m_info.m_id);
+    }
+    this->queueInGDThread([this] {
+        // taken out first so mods queued while saving wait for
+        // the next run instead of racing with this one
+        std::unordered_set<std::string> ids;
+        {
+            std::lock_guard lock(m_modsToSaveMutex);
+            ids.swap(m_modsToSave);
+        }
+        for (auto const& id : ids) {
+            auto mod = findModOrLoader(m_mods, id);
+            if (!mod) continue;
+            auto res = mod->saveSettings();
+            if (!res) {
+                log::log(Severity::Error, mod, "Unable to save settings: {}", res.error());
+            }
+        }
+    }, &m_modsToSave);
+}
+
+void InternalLoader::settingsChanged(std::string const& modID) {
+    if (auto mod = findModOrLoader(m_mods, modID)) {
+        mod->m_settingsDirty = true;
+        this->queueModSave(mod);
+    }
 }
 
 void InternalLoader::executeGDThreadQueue() {
-    // copy queue to avoid locking mutex if someone is 
-    // running addToGDThread inside their function
-    m_gdThreadMutex.lock();
-    auto queue = m_gdThreadQueue;
-    m_gdThreadQueue.clear();
-    m_gdThreadMutex.unlock();
-
-    // call queue
-    for (auto const& func : queue) {
-        func();
+    // anything queued by the functions run here waits for the
+    // next frame
+    if (auto incoming = m_gdThreadQueue.popAll()) {
+        if (m_gdThreadBacklogTail) {
+            m_gdThreadBacklogTail->m_next = incoming;
+        } else {
+            m_gdThreadBacklog = incoming;
+        }
+        for (auto task = incoming; task; task = task->m_next) {
+            m_gdThreadBacklogTail = task;
+            m_gdThreadBacklogSize++;
+            if (!task->m_key) continue;
+            auto& latest = m_gdThreadLatest[task->m_key];
+            if (latest) {
+                latest->m_superseded = true;
+            }
+            latest = task;
+        }
+    }
+    trace::counter("Loader::queueInGDThread backlog", m_gdThreadBacklogSize);
+
+    auto start = std::chrono::steady_clock::now();
+    while (m_gdThreadBacklog) {
+        auto task = m_gdThreadBacklog;
+        m_gdThreadBacklog = task->m_next;
+        m_gdThreadBacklogSize--;
+        if (!m_gdThreadBacklog) {
+            m_gdThreadBacklogTail = nullptr;
+        }
+        if (task->m_key && !task->m_superseded) {
+            m_gdThreadLatest.erase(task->m_key);
+        }
+        if (!task->m_superseded) {
+            trace::Scope scope("Loader::queueInGDThread", nullptr, "loader");
+            task->m_func();
+        }
+        delete task;
+
+        // whatever doesn't fit in this frame runs in the next
+        if (std::chrono::steady_clock::now() - start >= m_gdThreadBudget) {
+            break;
+        }
     }
 }
 
 void InternalLoader::logConsoleMessage(std::string const& msg) {
     if (m_platformConsoleOpen) {
-        // TODO: make flushing optional
-        std::cout << msg << '\n' << std::flush;
+        // called with whole batches of lines by the log sink,
+        // so flushing once per call is cheap
+        std::cout << msg << std::flush;
     }
 }
 
@@ -218,7 +426,7 @@ void InternalLoader::openPlatformConsole() {
     m_platformConsoleOpen = true;
 
     for (auto const& log : Loader::get()->getLogs()) {
-        std::cout << log->toString(true) << "\n";
+        std::cout << log.toString(true) << "\n";
     }
 }
 
@@ -246,7 +454,7 @@ void InternalLoader::openPlatformConsole() {
     m_platformConsoleOpen = true;
 
     for (auto const& log : Loader::get()->getLogs()) {
-        std::cout << log->toString(true) << "\n";
+        std::cout << log.toString(true) << "\n";
     }
 }
 
@@ -4,6 +4,7 @@
 #include <unordered_map>
 #include <vector>
 #include "FileWatcher.hpp"
+#include "MPSCQueue.hpp"
 #include <Geode/loader/Loader.hpp>
 #include <Geode/loader/Log.hpp>
 #include <Geode/utils/Result.hpp>
@@ -19,11 +20,48 @@ USE_GEODE_NAMESPACE();
  * @class InternalLoader
  */
 class InternalLoader : public Loader {
+public:
+	/**
+	 * What a mod binary's static initializers scheduled while it
+	 * was loaded on a worker thread. Handed over on the main thread
+	 * right before the mod's entry point runs
+	 */
+	struct ScheduleCapture {
+		std::vector<ScheduledFunction> m_functions;
+		std::vector<std::function<void(Mod*)>> m_logs;
+	};
+
 protected:
-	std::vector<std::function<void(void)>> m_gdThreadQueue;
-	mutable std::mutex m_gdThreadMutex;
+	/**
+	 * Function queued to run on the GD thread
+	 */
+	struct GDThreadTask {
+		GDThreadTask* m_next = nullptr;
+		ScheduledFunction m_func;
+		/**
+		 * Tasks with the same key replace each other; null if
+		 * the task should always run
+		 */
+		void const* m_key = nullptr;
+		bool m_superseded = false;
+	};
+
+	// producers push to the lock-free queue; the GD thread moves
+	// tasks into the backlog, which also holds tasks that didn't
+	// fit in the previous frame's time budget
+	MPSCQueue<GDThreadTask> m_gdThreadQueue;
+	GDThreadTask* m_gdThreadBacklog = nullptr;
+	GDThreadTask* m_gdThreadBacklogTail = nullptr;
+	size_t m_gdThreadBacklogSize = 0;
+	std::unordered_map<void const*, GDThreadTask*> m_gdThreadLatest;
+	std::chrono::microseconds m_gdThreadBudget = std::chrono::microseconds(4000);
+	std::unordered_map<Mod*, ScheduleCapture> m_scheduleCaptures;
 	bool m_platformConsoleOpen = false;
 	std::unordered_set<std::string> m_shownInfoAlerts;
+	// IDs of mods with changes waiting to be saved; changes may
+	// come from any thread
+	std::mutex m_modsToSaveMutex;
+	std::unordered_set<std::string> m_modsToSave;
 
 	void saveInfoAlerts(nlohmann::json& json);
 	void loadInfoAlerts(nlohmann::json& json);
@@ -50,8 +88,47 @@ public:
 	bool shownInfoAlert(std::string const& key);
 
 	void queueInGDThread(ScheduledFunction func);
+	void queueInGDThread(ScheduledFunction func, void const* key);
 	void executeGDThreadQueue();
 
+	/**
+	 * Capture the calling thread is scheduling into, if it's
+	 * loading a mod's binary ahead of time
+	 */
+	static ScheduleCapture* getScheduleCapture();
+	/**
+	 * Load the binaries of the mods that are about to be loaded on
+	 * worker threads. The mods mustn't depend on each other
+	 */
+	void loadBinariesAhead(std::vector<Mod*> const& mods);
+	/**
+	 * Schedule whatever a mod's binary scheduled while it was loaded
+	 * ahead, so its entry point releases it
+	 */
+	void releaseScheduleCapture(Mod* mod);
+	/**
+	 * Unload binaries that were loaded ahead for mods that didn't
+	 * end up loading
+	 */
+	void discardBinariesAhead();
+
+	/**
+	 * Stop deferring mods and queue the deferred ones to be loaded
+	 * one per task, in dependency order, so loading them is spread
+	 * over the frames after the main menu appears
+	 */
+	void loadDeferredMods();
+
+	/**
+	 * Queue a mod's changed files to be saved on the GD thread.
+	 * Every mod queued in the same frame is saved in one task
+	 */
+	void queueModSave(Mod* mod);
+	/**
+	 * Mark a mod's settings as changed and queue them to be saved
+	 */
+	void settingsChanged(std::string const& modID);
+
 	void logConsoleMessage(std::string const& msg);
 	bool platformConsoleOpen() const;
 	void openPlatformConsole();
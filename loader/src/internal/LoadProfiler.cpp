@@ -0,0 +1,147 @@
+#include "LoadProfiler.hpp"
+#include <Geode/loader/Loader.hpp>
+#include <Geode/loader/Log.hpp>
+#include <Geode/loader/Mod.hpp>
+#include <Geode/loader/Trace.hpp>
+#include <Geode/utils/file.hpp>
+#include <fmt/format.h>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+namespace {
+    double toMs(uint64_t ns) {
+        return ns / 1'000'000.0;
+    }
+}
+
+LoadProfiler& LoadProfiler::get() {
+    static auto inst = new LoadProfiler;
+    return *inst;
+}
+
+void LoadProfiler::add(
+    const char* name, Mod* mod, uint64_t start, uint64_t duration, bool traced
+) {
+    if (traced && trace::isCapturing()) {
+        trace::record({
+            .m_name = name,
+            .m_category = "startup",
+            .m_phase = trace::Phase::Complete,
+            .m_start = start,
+            .m_duration = duration,
+            .m_mod = mod,
+        });
+    }
+    std::lock_guard lock(m_mutex);
+    m_phases.push_back({ name, mod, start, duration });
+}
+
+uint64_t LoadProfiler::getModLoadTime(Mod* mod) const {
+    std::lock_guard lock(m_mutex);
+    uint64_t total = 0;
+    for (auto& phase : m_phases) {
+        if (phase.m_mod == mod) {
+            total += phase.m_duration;
+        }
+    }
+    return total;
+}
+
+std::vector<std::pair<Mod*, uint64_t>> LoadProfiler::getSlowestMods(size_t count) const {
+    std::unordered_map<Mod*, uint64_t> totals;
+    {
+        std::lock_guard lock(m_mutex);
+        for (auto& phase : m_phases) {
+            if (phase.m_mod) {
+                totals[phase.m_mod] += phase.m_duration;
+            }
+        }
+    }
+    std::vector<std::pair<Mod*, uint64_t>> res(totals.begin(), totals.end());
+    std::sort(res.begin(), res.end(), [](auto const& a, auto const& b) {
+        return a.second > b.second;
+    });
+    if (res.size() > count) {
+        res.resize(count);
+    }
+    return res;
+}
+
+void LoadProfiler::finish() {
+    std::vector<Phase> phases;
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_finished) return;
+        m_finished = true;
+        phases = m_phases;
+    }
+
+    // the log formatter only does plain {}, so the table is
+    // laid out here
+    log::info("Startup took {}", fmt::format("{:.1f} ms", toMs(trace::now())));
+    for (auto& phase : phases) {
+        if (!phase.m_mod) {
+            log::info("{}", fmt::format("  {:<28} {:>9.2f} ms", phase.m_name, toMs(phase.m_duration)));
+        }
+    }
+
+    auto slowest = this->getSlowestMods(10);
+    if (slowest.size()) {
+        log::info("Slowest mods to load:");
+    }
+    for (auto& [mod, total] : slowest) {
+        // break the total down by phase, in the order they ran
+        std::vector<std::pair<const char*, uint64_t>> parts;
+        for (auto& phase : phases) {
+            if (phase.m_mod != mod) continue;
+            auto it = std::find_if(parts.begin(), parts.end(), [&](auto const& part) {
+                return std::string_view(part.first) == phase.m_name;
+            });
+            if (it == parts.end()) {
+                parts.push_back({ phase.m_name, phase.m_duration });
+            } else {
+                it->second += phase.m_duration;
+            }
+        }
+        std::string breakdown;
+        for (auto& [name, time] : parts) {
+            if (breakdown.size()) breakdown += ", ";
+            breakdown += fmt::format("{} {:.2f}", name, toMs(time));
+        }
+        log::info("{}", fmt::format(
+            "  {:<28} {:>9.2f} ms ({})", mod->getID(), toMs(total), breakdown
+        ));
+    }
+
+    // made from the phases kept here, since they only went into
+    // the trace buffers if a capture was running
+    std::vector<std::string> modIDs(phases.size());
+    std::vector<trace::Record> records;
+    for (size_t i = 0; i < phases.size(); i++) {
+        auto& phase = phases[i];
+        if (phase.m_mod) {
+            modIDs[i] = phase.m_mod->getID();
+        }
+        records.push_back({
+            .m_name = phase.m_name,
+            .m_category = "startup",
+            .m_phase = trace::Phase::Complete,
+            .m_start = phase.m_start,
+            .m_duration = phase.m_duration,
+            .m_modID = phase.m_mod ? modIDs[i].c_str() : nullptr,
+        });
+    }
+    auto path = Loader::get()->getGeodeDirectory() / GEODE_LOG_DIRECTORY / "startup.json";
+    auto res = utils::file::writeString(path, trace::exportChromeTrace(records));
+    if (!res) {
+        log::warn("Unable to save startup trace: {}", res.error());
+    }
+}
+
+LoadPhase::LoadPhase(const char* name, Mod* mod)
+  : m_name(name), m_mod(mod), m_start(trace::now()) {}
+
+LoadPhase::~LoadPhase() {
+    LoadProfiler::get().add(m_name, m_mod, m_start, trace::now() - m_start);
+}
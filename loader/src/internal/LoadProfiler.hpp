@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Geode/DefaultInclude.hpp>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace geode {
+	class Mod;
+}
+
+USE_GEODE_NAMESPACE();
+
+/**
+ * Times the phases of starting up and of loading each mod. Phases
+ * are kept here so startup can be inspected after the fact, and
+ * only go into the trace buffers while a capture is running
+ */
+class LoadProfiler {
+public:
+	struct Phase {
+		/**
+		 * Must have static lifetime
+		 */
+		const char* m_name;
+		/**
+		 * Mod the phase belongs to, or null for the loader's
+		 * own phases
+		 */
+		Mod* m_mod;
+		uint64_t m_start;
+		uint64_t m_duration;
+	};
+
+protected:
+	mutable std::mutex m_mutex;
+	std::vector<Phase> m_phases;
+	bool m_finished = false;
+
+	LoadProfiler() = default;
+
+public:
+	static LoadProfiler& get();
+
+	/**
+	 * Record a finished phase
+	 * @param start Start time on the trace clock
+	 * @param traced Whether to add it to the calling thread's
+	 * trace buffer if a capture is running; off if it was traced
+	 * by the thread that ran it
+	 */
+	void add(const char* name, Mod* mod, uint64_t start, uint64_t duration, bool traced = true);
+
+	/**
+	 * Log a summary of startup and save it as a Chrome trace in
+	 * the logs directory. Only does anything the first time
+	 */
+	void finish();
+
+	/**
+	 * Total time spent loading a mod, in nanoseconds
+	 */
+	uint64_t getModLoadTime(Mod* mod) const;
+	/**
+	 * Mods that took the longest to load, slowest first
+	 */
+	std::vector<std::pair<Mod*, uint64_t>> getSlowestMods(size_t count) const;
+};
+
+/**
+ * Times a load phase for as long as it's in scope
+ */
+class LoadPhase {
+protected:
+	const char* m_name;
+	Mod* m_mod;
+	uint64_t m_start;
+
+public:
+	LoadPhase(const char* name, Mod* mod = nullptr);
+	~LoadPhase();
+
+	LoadPhase(LoadPhase const&) = delete;
+	LoadPhase& operator=(LoadPhase const&) = delete;
+};
@@ -0,0 +1,373 @@
+#include "LogSink.hpp"
+#include <fmt/format.h>
+#include <fmt/chrono.h>
+#include <../platform/IncludeZlib.h>
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+    bool isLogFile(ghc::filesystem::path const& path) {
+        auto ext = path.extension();
+        return path.filename().string().starts_with("Geode ") &&
+            (ext == ".log" || ext == ".glog" || ext == ".gz");
+    }
+
+    bool compressFile(ghc::filesystem::path const& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+
+        // write to a temporary name first so a half-written
+        // archive is never mistaken for a finished one
+        auto target = path.string() + ".gz";
+        auto temp = target + ".tmp";
+        auto out = gzopen(temp.c_str(), "wb");
+        if (!out) return false;
+
+        char buffer[64 * 1024];
+        bool ok = true;
+        while (in && ok) {
+            in.read(buffer, sizeof(buffer));
+            auto read = static_cast<unsigned>(in.gcount());
+            if (read && gzwrite(out, buffer, read) != static_cast<int>(read)) {
+                ok = false;
+            }
+        }
+        ok = gzclose(out) == Z_OK && ok;
+        in.close();
+
+        std::error_code ec;
+        if (ok) {
+            ghc::filesystem::rename(temp, target, ec);
+            ok = !ec;
+        }
+        if (ok) {
+            // keep the original time so retention still sees
+            // how old the log is
+            auto time = ghc::filesystem::last_write_time(path, ec);
+            if (!ec) {
+                ghc::filesystem::last_write_time(target, time, ec);
+            }
+        }
+        if (ok) {
+            ghc::filesystem::remove(path, ec);
+        } else {
+            ghc::filesystem::remove(temp, ec);
+        }
+        return ok;
+    }
+
+    /**
+     * Delete old logs that fall outside the retention policy
+     * and compress the rest
+     */
+    void enforceRetention(
+        ghc::filesystem::path const& current, geode::log::LogRetention const& retention
+    ) {
+        struct OldLog {
+            ghc::filesystem::path m_path;
+            ghc::filesystem::file_time_type m_time;
+            uintmax_t m_size;
+        };
+        std::vector<OldLog> logs;
+
+        std::error_code ec;
+        for (auto& entry : ghc::filesystem::directory_iterator(current.parent_path(), ec)) {
+            auto path = entry.path();
+            // leftover from an interrupted compression
+            if (path.string().ends_with(".gz.tmp")) {
+                ghc::filesystem::remove(path, ec);
+                continue;
+            }
+            if (path == current || !entry.is_regular_file(ec) || !isLogFile(path)) {
+                continue;
+            }
+            logs.push_back({ path, entry.last_write_time(ec), entry.file_size(ec) });
+        }
+
+        // newest first
+        std::sort(logs.begin(), logs.end(), [](auto const& a, auto const& b) {
+            return a.m_time > b.m_time;
+        });
+
+        auto now = ghc::filesystem::file_time_type::clock::now();
+        // the current log counts towards the file limit
+        size_t kept = 1;
+        uintmax_t keptBytes = 0;
+        for (auto& log : logs) {
+            auto expired = now - log.m_time > retention.m_maxAge;
+            if (kept >= retention.m_maxFiles || keptBytes + log.m_size > retention.m_maxBytes || expired) {
+                ghc::filesystem::remove(log.m_path, ec);
+                continue;
+            }
+            kept++;
+            keptBytes += log.m_size;
+            if (retention.m_compress && log.m_path.extension() != ".gz") {
+                compressFile(log.m_path);
+            }
+        }
+    }
+}
+
+LogSink::LogSink() : m_slots(std::make_unique<Slot[]>(CAPACITY)) {
+    for (size_t i = 0; i < CAPACITY; i++) {
+        m_slots[i].m_sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+LogSink& LogSink::get() {
+    static auto inst = new LogSink;
+    return *inst;
+}
+
+void LogSink::setOutput(Output output) {
+    std::lock_guard lock(m_drainMutex);
+    m_output = std::move(output);
+}
+
+LogSink::LogSender const* LogSink::getSender(std::string id, std::string name) {
+    std::lock_guard lock(m_sendersMutex);
+    return &*m_senders.insert({ std::move(id), std::move(name) }).first;
+}
+
+size_t LogSink::getSenderGeneration() const {
+    return m_senderGeneration.load(std::memory_order_acquire);
+}
+
+void LogSink::prepareUnload() {
+    std::lock_guard lock(m_drainMutex);
+    this->drain(false);
+    m_formatAddresses.clear();
+    m_senderGeneration.fetch_add(1, std::memory_order_release);
+}
+
+std::string_view LogSink::internFormat(std::string_view format) {
+    auto it = m_formatAddresses.find(format.data());
+    if (it != m_formatAddresses.end()) {
+        return it->second;
+    }
+    std::string_view interned = *m_formats.insert(std::string(format)).first;
+    m_formatAddresses.insert({ format.data(), interned });
+    return interned;
+}
+
+bool LogSink::tryPush(LogRecord& record) {
+    // each slot's sequence tells whose turn it is: equal to the
+    // position means free for that producer, position + 1 means
+    // filled and waiting for the writer
+    auto pos = m_tail.load(std::memory_order_relaxed);
+    while (true) {
+        auto& slot = m_slots[pos % CAPACITY];
+        auto seq = slot.m_sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.m_record = std::move(record);
+                slot.m_sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // full
+            return false;
+        } else {
+            pos = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void LogSink::push(LogRecord&& record) {
+    auto severe = record.m_severity >= SEVERE;
+    while (!this->tryPush(record)) {
+        // the writer can't keep up (or hasn't started), so
+        // write out the backlog here instead of dropping logs
+        std::lock_guard lock(m_drainMutex);
+        this->drain(false);
+    }
+    if (severe) {
+        m_flushRequested.store(true, std::memory_order_relaxed);
+        m_wake.notify_one();
+    }
+}
+
+void LogSink::drain(bool forceFlush) {
+    std::string batch;
+    std::string binary;
+    bool severe = false;
+    auto writeBinary = m_binary.load(std::memory_order_relaxed);
+    auto console = m_output.m_console && (!m_output.m_consoleOpen || m_output.m_consoleOpen());
+    // the console always gets text, but binary logs don't need it
+    auto writeText = console || !writeBinary;
+    while (true) {
+        auto& slot = m_slots[m_head % CAPACITY];
+        if (slot.m_sequence.load(std::memory_order_acquire) != m_head + 1) {
+            break;
+        }
+        auto record = std::move(slot.m_record);
+        slot.m_sequence.store(m_head + CAPACITY, std::memory_order_release);
+        m_head++;
+
+        record.m_format = this->internFormat(record.m_format);
+        if (writeText) {
+            fmt::format_to(
+                std::back_inserter(batch), "{:%H:%M:%S} [{}]: ",
+                record.m_time, record.m_sender ? record.m_sender->m_name : "?"
+            );
+            geode::log::renderLog(batch, record.m_format, record.getArgs());
+            batch += '\n';
+        }
+        severe |= record.m_severity >= SEVERE;
+
+        if (m_file.is_open()) {
+            if (writeBinary) {
+                this->encode(record, binary);
+            }
+        } else {
+            m_beforeStart.push_back(record);
+        }
+        if (m_output.m_onLog) {
+            m_output.m_onLog(record);
+        }
+    }
+
+    if (console && !batch.empty()) {
+        m_output.m_console(batch);
+    }
+    if (m_file.is_open()) {
+        auto& fileBatch = writeBinary ? binary : batch;
+        if (!fileBatch.empty()) {
+            m_file.write(fileBatch.data(), fileBatch.size());
+        }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (m_file.is_open() && (forceFlush || severe || now - m_lastFlush >= FLUSH_INTERVAL)) {
+        m_file.flush();
+        m_lastFlush = now;
+    }
+}
+
+void LogSink::writerMain() {
+    while (m_running.load(std::memory_order_relaxed)) {
+        {
+            std::unique_lock lock(m_wakeMutex);
+            m_wake.wait_for(lock, POLL_INTERVAL, [this] {
+                return m_flushRequested.load(std::memory_order_relaxed) ||
+                    !m_running.load(std::memory_order_relaxed);
+            });
+        }
+        auto flush = m_flushRequested.exchange(false, std::memory_order_relaxed);
+        std::lock_guard lock(m_drainMutex);
+        this->drain(flush);
+    }
+}
+
+void LogSink::open(ghc::filesystem::path const& file) {
+    std::lock_guard lock(m_drainMutex);
+    std::string out;
+    if (m_binary) {
+        m_file = std::ofstream(file, std::ios::binary);
+        m_formatIDs.clear();
+        m_modIDs.clear();
+        out.append(binlog::MAGIC, sizeof(binlog::MAGIC));
+        binlog::put<uint32_t>(out, binlog::VERSION);
+        for (auto const& record : m_beforeStart) {
+            this->encode(record, out);
+        }
+    } else {
+        m_file = std::ofstream(file);
+        for (auto const& record : m_beforeStart) {
+            fmt::format_to(
+                std::back_inserter(out), "{:%H:%M:%S} [{}]: ",
+                record.m_time, record.m_sender ? record.m_sender->m_name : "?"
+            );
+            geode::log::renderLog(out, record.m_format, record.getArgs());
+            out += '\n';
+        }
+    }
+    m_file.write(out.data(), out.size());
+    m_beforeStart.clear();
+    m_beforeStart.shrink_to_fit();
+    m_lastFlush = std::chrono::steady_clock::now();
+}
+
+void LogSink::start(
+    ghc::filesystem::path const& file, bool binary, geode::log::LogRetention const& retention
+) {
+    m_binary = binary;
+    if (m_running.exchange(true)) {
+        this->open(file);
+        return;
+    }
+    // opening the file happens on the writer thread so it doesn't
+    // hold up loading
+    m_writer = std::thread([this, file] {
+        this->open(file);
+        this->writerMain();
+    });
+    // compressing old logs can take a while, so it gets a thread of
+    // its own instead of holding up writing. Interrupted compressions
+    // are cleaned up next time
+    std::thread([file, retention] {
+        enforceRetention(file, retention);
+    }).detach();
+
+    static bool registeredExit = false;
+    if (!registeredExit) {
+        registeredExit = true;
+        std::atexit(+[] { LogSink::get().flush(); });
+    }
+}
+
+void LogSink::stop() {
+    if (m_running.exchange(false)) {
+        m_wake.notify_one();
+        m_writer.join();
+    }
+    std::lock_guard lock(m_drainMutex);
+    this->drain(true);
+}
+
+void LogSink::encode(LogRecord const& record, std::string& out) {
+    auto format = m_formatIDs.find(record.m_format.data());
+    if (format == m_formatIDs.end()) {
+        auto id = static_cast<uint32_t>(m_formatIDs.size());
+        format = m_formatIDs.insert({ record.m_format.data(), id }).first;
+        binlog::put(out, binlog::Tag::Format);
+        binlog::put<uint32_t>(out, id);
+        binlog::putString(out, record.m_format);
+    }
+    auto mod = m_modIDs.find(record.m_sender);
+    if (mod == m_modIDs.end()) {
+        auto id = static_cast<uint32_t>(m_modIDs.size());
+        mod = m_modIDs.insert({ record.m_sender, id }).first;
+        binlog::put(out, binlog::Tag::Mod);
+        binlog::put<uint32_t>(out, id);
+        binlog::putString(out, record.m_sender ? record.m_sender->m_id : "?");
+    }
+
+    binlog::put(out, binlog::Tag::Record);
+    binlog::put<int64_t>(out, std::chrono::duration_cast<std::chrono::nanoseconds>(
+        record.m_time.time_since_epoch()
+    ).count());
+    binlog::put<uint32_t>(out, mod->second);
+    binlog::put<uint8_t>(out, record.m_severity);
+    binlog::put<uint32_t>(out, format->second);
+    binlog::put<uint8_t>(out, record.m_argCount);
+    // arguments are stored as they were logged; they're only
+    // turned into text when the log is read
+    auto args = record.getArgs();
+    binlog::put<uint32_t>(out, static_cast<uint32_t>(args.size()));
+    out.append(args.data(), args.size());
+}
+
+void LogSink::flush() {
+    // if the writer crashed or is otherwise stuck while holding
+    // the lock, losing the backlog beats hanging forever
+    for (int i = 0; i < 100; i++) {
+        if (m_drainMutex.try_lock()) {
+            this->drain(true);
+            m_drainMutex.unlock();
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <Geode/loader/LogRecord.hpp>
+#include "BinaryLog.hpp"
+#include <fs/filesystem.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Writes logs to the console and the log file on a background
+ * thread. Pushing is lock-free and never touches the console or
+ * the disk unless the buffer is full, in which case the pushing
+ * thread writes out the backlog itself. Messages are put together
+ * from their format string and arguments by whoever writes them
+ * out, not by the thread that logged them. Doesn't depend on the
+ * rest of the loader, so geode-bench can time it
+ */
+class LogSink {
+public:
+	using LogRecord = geode::log::LogRecord;
+	using LogSender = geode::log::LogSender;
+
+	/**
+	 * Logs at least this severe are flushed to disk right away.
+	 * Same as Severity::Error
+	 */
+	static constexpr uint8_t SEVERE = 4;
+
+	/**
+	 * Where logs go besides the log file. Called by whoever is
+	 * writing out logs, with the drain lock held
+	 */
+	struct Output {
+		/**
+		 * Called with every log once it's written. Its format
+		 * string is interned, so it stays valid for the rest of
+		 * the process and the message can be put together later
+		 */
+		std::function<void(LogRecord const& record)> m_onLog;
+		/**
+		 * Called with batches of lines for the console
+		 */
+		std::function<void(std::string const& lines)> m_console;
+		/**
+		 * Whether anyone is looking at the console. In binary
+		 * mode, messages are only turned into text while it is
+		 */
+		std::function<bool()> m_consoleOpen;
+	};
+
+protected:
+	struct Slot {
+		std::atomic<size_t> m_sequence;
+		LogRecord m_record;
+	};
+
+	static constexpr size_t CAPACITY = 1 << 13;
+	static constexpr auto POLL_INTERVAL = std::chrono::milliseconds(25);
+	static constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(500);
+
+	std::unique_ptr<Slot[]> m_slots;
+	alignas(64) std::atomic<size_t> m_tail = 0;
+	alignas(64) size_t m_head = 0;
+
+	// held by whoever is currently writing out records
+	std::mutex m_drainMutex;
+	std::ofstream m_file;
+	// records written out before the log file was opened
+	std::vector<LogRecord> m_beforeStart;
+	std::chrono::steady_clock::time_point m_lastFlush;
+	Output m_output;
+
+	std::mutex m_sendersMutex;
+	std::set<LogSender> m_senders;
+	std::atomic<size_t> m_senderGeneration = 0;
+
+	std::thread m_writer;
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wake;
+	std::atomic<bool> m_running = false;
+	std::atomic<bool> m_flushRequested = false;
+
+	// every format string seen, kept for the rest of the process;
+	// only as many as there are logging calls in loaded mods
+	std::unordered_set<std::string> m_formats;
+	// format strings are literals, so they're looked up by address
+	// until a mod is unloaded and its addresses may be reused
+	std::unordered_map<char const*, std::string_view> m_formatAddresses;
+
+	std::atomic<bool> m_binary = false;
+	// keyed by the interned format string
+	std::unordered_map<char const*, uint32_t> m_formatIDs;
+	std::unordered_map<LogSender const*, uint32_t> m_modIDs;
+
+	/**
+	 * The copy of a format string kept in m_formats. Must hold
+	 * m_drainMutex
+	 */
+	std::string_view internFormat(std::string_view format);
+	void encode(LogRecord const& record, std::string& out);
+
+	LogSink();
+
+	bool tryPush(LogRecord& record);
+	/**
+	 * Write out every queued record. Must hold m_drainMutex
+	 */
+	void drain(bool forceFlush);
+	void writerMain();
+	void open(ghc::filesystem::path const& file);
+
+public:
+	static LogSink& get();
+
+	/**
+	 * Set where logs go besides the log file. Must be called
+	 * before anything is logged
+	 */
+	void setOutput(Output output);
+
+	/**
+	 * Start the writer thread, which opens the log file, and
+	 * clean up old logs according to the retention policy on
+	 * another thread. Records pushed before the file is open
+	 * are kept and written once it is
+	 * @param binary Write the binary log format instead of text
+	 */
+	void start(
+		ghc::filesystem::path const& file, bool binary,
+		geode::log::LogRetention const& retention
+	);
+	/**
+	 * Write out everything queued and stop the writer thread
+	 */
+	void stop();
+
+	void push(LogRecord&& record);
+
+	/**
+	 * The one LogSender with this ID and name, for records to
+	 * point to. Cache it per mod, and look it up again when the
+	 * sender generation changes
+	 */
+	LogSender const* getSender(std::string id, std::string name);
+	size_t getSenderGeneration() const;
+	/**
+	 * Write out everything queued before a mod's binary is
+	 * unloaded, since queued records point into it, and forget
+	 * the format string addresses cached for it
+	 */
+	void prepareUnload();
+
+	/**
+	 * Write out and flush everything queued on the calling
+	 * thread. Safe to call from a crash handler; gives up if
+	 * the writer appears stuck
+	 */
+	void flush();
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+
+/**
+ * Intrusive lock-free multi-producer single-consumer queue.
+ * Nodes must have a `T* m_next` member. Any thread may push;
+ * only one thread may take nodes out. Producers only do a
+ * single CAS on the head, and the consumer takes the whole
+ * queue at once with an exchange
+ */
+template <class T>
+class MPSCQueue {
+protected:
+	std::atomic<T*> m_head = nullptr;
+
+public:
+	void push(T* node) {
+		node->m_next = m_head.load(std::memory_order_relaxed);
+		while (!m_head.compare_exchange_weak(
+			node->m_next, node,
+			std::memory_order_release,
+			std::memory_order_relaxed
+		));
+	}
+
+	bool empty() const {
+		return m_head.load(std::memory_order_relaxed) == nullptr;
+	}
+
+	/**
+	 * Take every node currently in the queue
+	 * @returns Singly linked list of the nodes in the
+	 * order they were pushed, or nullptr if empty
+	 */
+	T* popAll() {
+		auto node = m_head.exchange(nullptr, std::memory_order_acquire);
+		// nodes are linked newest first, so reverse them
+		T* res = nullptr;
+		while (node) {
+			auto next = node->m_next;
+			node->m_next = res;
+			res = node;
+			node = next;
+		}
+		return res;
+	}
+};
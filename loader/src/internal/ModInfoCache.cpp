@@ -0,0 +1,127 @@
+#include "ModInfoCache.hpp"
+#include "FileWriter.hpp"
+#include <fstream>
+#include <sstream>
+
+using Json = nlohmann::ordered_json;
+
+ModInfoCache& ModInfoCache::get() {
+    static auto inst = new ModInfoCache;
+    return *inst;
+}
+
+std::optional<std::pair<uintmax_t, int64_t>> ModInfoCache::stat(
+    ghc::filesystem::path const& path
+) {
+    std::error_code ec;
+    auto size = ghc::filesystem::file_size(path, ec);
+    if (ec) return std::nullopt;
+    auto modified = ghc::filesystem::last_write_time(path, ec);
+    if (ec) return std::nullopt;
+    return std::make_pair(size, static_cast<int64_t>(modified.time_since_epoch().count()));
+}
+
+void ModInfoCache::load(ghc::filesystem::path const& file, std::string const& loaderVersion) {
+    std::lock_guard lock(m_mutex);
+    m_entries.clear();
+    m_loaderVersion = loaderVersion;
+    m_dirty = false;
+
+    std::ifstream stream(file, std::ios::binary);
+    if (!stream.is_open()) return;
+    std::stringstream read;
+    read << stream.rdbuf();
+
+    try {
+        auto json = Json::parse(read.str());
+        // special files are sanitized by the loader that read
+        // them, so anything from another version is redone
+        if (
+            json.value("version", 0) != VERSION ||
+            json.value("loader", "") != loaderVersion
+        ) {
+            m_dirty = true;
+            return;
+        }
+        for (auto& [path, value] : json.at("mods").items()) {
+            Entry entry;
+            entry.m_size = value.at("size");
+            entry.m_modified = value.at("modified");
+            entry.m_json = value.at("mod");
+            for (auto& [name, data] : value.at("files").items()) {
+                entry.m_files.push_back({ name, data });
+            }
+            m_entries.insert({ path, std::move(entry) });
+        }
+    } catch(std::exception const&) {
+        // a broken cache is as good as none
+        m_entries.clear();
+        m_dirty = true;
+    }
+}
+
+std::optional<std::string> ModInfoCache::save(ghc::filesystem::path const& file) {
+    std::lock_guard lock(m_mutex);
+    std::error_code ec;
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (!ghc::filesystem::exists(it->first, ec)) {
+            it = m_entries.erase(it);
+            m_dirty = true;
+        } else {
+            it++;
+        }
+    }
+    if (!m_dirty) return std::nullopt;
+
+    auto mods = Json::object();
+    for (auto& [path, entry] : m_entries) {
+        auto files = Json::object();
+        for (auto& [name, data] : entry.m_files) {
+            files[name] = data;
+        }
+        mods[path] = {
+            { "size", entry.m_size },
+            { "modified", entry.m_modified },
+            { "mod", entry.m_json },
+            { "files", files },
+        };
+    }
+    auto json = Json::object();
+    json["version"] = VERSION;
+    json["loader"] = m_loaderVersion;
+    json["mods"] = mods;
+
+    auto error = FileWriter::writeAtomic(file, json.dump());
+    if (!error) {
+        m_dirty = false;
+    }
+    return error;
+}
+
+std::optional<ModInfoCache::Entry> ModInfoCache::find(ghc::filesystem::path const& archive) const {
+    auto current = stat(archive);
+    if (!current) return std::nullopt;
+
+    std::lock_guard lock(m_mutex);
+    auto it = m_entries.find(archive.string());
+    if (
+        it == m_entries.end() ||
+        it->second.m_size != current->first ||
+        it->second.m_modified != current->second
+    ) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void ModInfoCache::store(
+    ghc::filesystem::path const& archive, Json const& json,
+    std::vector<std::pair<std::string, std::string>> const& files
+) {
+    auto current = stat(archive);
+    if (!current) return;
+
+    std::lock_guard lock(m_mutex);
+    m_entries[archive.string()] = { current->first, current->second, json, files };
+    m_dirty = true;
+}
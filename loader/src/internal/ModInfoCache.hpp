@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Geode/utils/json.hpp>
+#include <fs/filesystem.hpp>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Keeps what was read out of each .geode archive, so archives that
+ * haven't changed since the last launch don't have to be opened.
+ * Archives are told apart by path, size and modification time.
+ * Safe to use from several threads. Doesn't depend on the rest of
+ * the loader, so geode-bench can time it
+ */
+class ModInfoCache {
+public:
+	struct Entry {
+		uintmax_t m_size = 0;
+		int64_t m_modified = 0;
+		nlohmann::ordered_json m_json;
+		/**
+		 * Special files (about.md etc.) found in the archive,
+		 * already sanitized
+		 */
+		std::vector<std::pair<std::string, std::string>> m_files;
+	};
+
+protected:
+	static constexpr int VERSION = 1;
+
+	mutable std::mutex m_mutex;
+	std::unordered_map<std::string, Entry> m_entries;
+	std::string m_loaderVersion;
+	bool m_dirty = false;
+
+	ModInfoCache() = default;
+
+	/**
+	 * Get an archive's current size and modification time
+	 */
+	static std::optional<std::pair<uintmax_t, int64_t>> stat(ghc::filesystem::path const& path);
+
+public:
+	static ModInfoCache& get();
+
+	/**
+	 * Read the cache from disk, replacing anything in memory. A
+	 * missing file, or one written by another loader version,
+	 * just leaves the cache empty
+	 */
+	void load(ghc::filesystem::path const& file, std::string const& loaderVersion);
+	/**
+	 * Write the cache to disk if anything changed, dropping
+	 * entries for archives that no longer exist
+	 * @returns An error message on failure
+	 */
+	std::optional<std::string> save(ghc::filesystem::path const& file);
+
+	/**
+	 * Get the cached contents of an archive, if they're there
+	 * and the archive hasn't changed since
+	 */
+	std::optional<Entry> find(ghc::filesystem::path const& archive) const;
+	void store(
+		ghc::filesystem::path const& archive, nlohmann::ordered_json const& json,
+		std::vector<std::pair<std::string, std::string>> const& files
+	);
+};
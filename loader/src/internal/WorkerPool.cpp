@@ -0,0 +1,61 @@
+#include "WorkerPool.hpp"
+#include <algorithm>
+
+WorkerPool& WorkerPool::get() {
+    static auto inst = new WorkerPool;
+    return *inst;
+}
+
+size_t WorkerPool::getThreadCount() {
+    std::lock_guard lock(m_mutex);
+    return m_threads.size();
+}
+
+void WorkerPool::work() {
+    for (size_t i; (i = m_next.fetch_add(1)) < m_count;) {
+        (*m_func)(i);
+    }
+}
+
+void WorkerPool::threadMain() {
+    std::unique_lock lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this] { return m_wanted > 0; });
+        m_wanted--;
+        m_busy++;
+        lock.unlock();
+        this->work();
+        lock.lock();
+        if (--m_busy == 0) {
+            m_done.notify_all();
+        }
+    }
+}
+
+void WorkerPool::forEach(size_t count, std::function<void(size_t index)> const& func) {
+    if (!count) return;
+    std::lock_guard run(m_runMutex);
+
+    // the calling thread does its share too
+    auto cores = std::max(std::thread::hardware_concurrency(), 1u);
+    auto helpers = std::min<size_t>(cores - 1, count - 1);
+    {
+        std::lock_guard lock(m_mutex);
+        while (m_threads.size() < helpers) {
+            m_threads.emplace_back([this] { this->threadMain(); });
+        }
+        m_func = &func;
+        m_count = count;
+        m_next = 0;
+        m_wanted = helpers;
+    }
+    m_wake.notify_all();
+    this->work();
+
+    std::unique_lock lock(m_mutex);
+    // workers that haven't woken up yet would find nothing left
+    m_wanted = 0;
+    m_done.wait(lock, [this] { return m_busy == 0; });
+    m_func = nullptr;
+    m_count = 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Threads shared by everything the loader spreads over several
+ * cores, like parsing mod.json files and loading binaries. They're
+ * started the first time they're needed and then kept, so loading
+ * doesn't start a new set of threads for every step. Doesn't depend
+ * on the rest of the loader, so it can be tested on its own
+ */
+class WorkerPool {
+protected:
+	// held for the whole of a forEach, so they don't mix
+	std::mutex m_runMutex;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	std::vector<std::thread> m_threads;
+
+	std::function<void(size_t)> const* m_func = nullptr;
+	size_t m_count = 0;
+	std::atomic<size_t> m_next = 0;
+	// workers still to join the current forEach
+	size_t m_wanted = 0;
+	// workers currently running it
+	size_t m_busy = 0;
+
+	WorkerPool() = default;
+
+	void threadMain();
+	/**
+	 * Call m_func with indices until there are none left
+	 */
+	void work();
+
+public:
+	static WorkerPool& get();
+
+	/**
+	 * Number of worker threads started so far
+	 */
+	size_t getThreadCount();
+
+	/**
+	 * Call a function with every index below count, spread over
+	 * the workers and the calling thread, and wait for all of the
+	 * calls to return. Must not be called from inside func, and
+	 * func must not throw
+	 */
+	void forEach(size_t count, std::function<void(size_t index)> const& func);
+};
@@ -0,0 +1,113 @@
+#include "ZipDirectory.hpp"
+#include <../platform/IncludeZlib.h>
+#include <cstring>
+
+namespace {
+    template <class T>
+    T readLE(unsigned char const* data) {
+        T res;
+        std::memcpy(&res, data, sizeof(T));
+        return res;
+    }
+
+    constexpr uint32_t LOCAL_HEADER_SIG = 0x04034b50;
+    constexpr uint32_t CENTRAL_HEADER_SIG = 0x02014b50;
+    constexpr uint32_t END_OF_DIRECTORY_SIG = 0x06054b50;
+    constexpr size_t LOCAL_HEADER_SIZE = 30;
+    constexpr size_t CENTRAL_HEADER_SIZE = 46;
+    constexpr size_t END_OF_DIRECTORY_SIZE = 22;
+}
+
+bool ZipDirectory::Entry::isSupported() const {
+    return !(m_flags & 1) && (
+        (m_method == METHOD_STORED && m_compressedSize == m_size) ||
+        m_method == METHOD_DEFLATED
+    );
+}
+
+std::optional<std::string> ZipDirectory::read(
+    unsigned char const* data, size_t size, std::vector<Entry>& entries
+) {
+    if (size < END_OF_DIRECTORY_SIZE) {
+        return "File is too small to be a zip archive";
+    }
+
+    // the end of directory record is at the end of the file,
+    // possibly followed by a comment of up to 64kb
+    size_t end = size - END_OF_DIRECTORY_SIZE;
+    size_t searchLimit = end > 0xffff ? end - 0xffff : 0;
+    while (readLE<uint32_t>(data + end) != END_OF_DIRECTORY_SIG) {
+        if (end == searchLimit) {
+            return "File is not a zip archive";
+        }
+        end--;
+    }
+    auto count = readLE<uint16_t>(data + end + 10);
+    size_t pos = readLE<uint32_t>(data + end + 16);
+    if (pos == 0xffffffff) {
+        return "Zip64 archives are not supported";
+    }
+
+    entries.reserve(entries.size() + count);
+    for (uint16_t i = 0; i < count; i++) {
+        if (pos + CENTRAL_HEADER_SIZE > size || readLE<uint32_t>(data + pos) != CENTRAL_HEADER_SIG) {
+            return "Zip directory is corrupted";
+        }
+        auto nameLength = readLE<uint16_t>(data + pos + 28);
+        if (pos + CENTRAL_HEADER_SIZE + nameLength > size) {
+            return "Zip directory is corrupted";
+        }
+        entries.push_back({
+            .m_name = std::string(
+                reinterpret_cast<char const*>(data + pos + CENTRAL_HEADER_SIZE), nameLength
+            ),
+            .m_flags = readLE<uint16_t>(data + pos + 8),
+            .m_method = readLE<uint16_t>(data + pos + 10),
+            .m_compressedSize = readLE<uint32_t>(data + pos + 20),
+            .m_size = readLE<uint32_t>(data + pos + 24),
+            .m_localOffset = readLE<uint32_t>(data + pos + 42),
+        });
+        pos += CENTRAL_HEADER_SIZE + nameLength +
+            readLE<uint16_t>(data + pos + 30) +
+            readLE<uint16_t>(data + pos + 32);
+    }
+    return std::nullopt;
+}
+
+std::optional<size_t> ZipDirectory::getDataOffset(
+    unsigned char const* data, size_t size, Entry const& entry
+) {
+    // the local header's extra field can differ from the one
+    // in the directory, so the data offset has to come from it
+    auto local = entry.m_localOffset;
+    if (local + LOCAL_HEADER_SIZE > size || readLE<uint32_t>(data + local) != LOCAL_HEADER_SIG) {
+        return std::nullopt;
+    }
+    auto offset = local + LOCAL_HEADER_SIZE +
+        readLE<uint16_t>(data + local + 26) +
+        readLE<uint16_t>(data + local + 28);
+    if (offset + entry.m_compressedSize > size) {
+        return std::nullopt;
+    }
+    return offset;
+}
+
+bool ZipDirectory::extract(
+    unsigned char const* src, uint16_t method,
+    uint32_t compressedSize, uint32_t size, unsigned char* out
+) {
+    if (method == METHOD_STORED) {
+        std::memcpy(out, src, size);
+        return true;
+    }
+    // entries are raw deflate streams without zlib headers
+    z_stream stream {};
+    stream.next_in = const_cast<Bytef*>(src);
+    stream.avail_in = compressedSize;
+    stream.next_out = out;
+    stream.avail_out = size;
+    auto ok = inflateInit2(&stream, -MAX_WBITS) == Z_OK;
+    ok = ok && inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.total_out == size;
+    inflateEnd(&stream);
+    return ok;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Reads zip archives that are already in memory. Doesn't depend on
+ * the rest of the loader or cocos, so tools like geode-bench can
+ * read .geode files the same way the loader does
+ */
+class ZipDirectory {
+public:
+	static constexpr uint16_t METHOD_STORED = 0;
+	static constexpr uint16_t METHOD_DEFLATED = 8;
+
+	struct Entry {
+		std::string m_name;
+		uint16_t m_flags;
+		uint16_t m_method;
+		uint32_t m_compressedSize;
+		uint32_t m_size;
+		size_t m_localOffset;
+
+		/**
+		 * Whether the entry can be read with extract()
+		 */
+		bool isSupported() const;
+	};
+
+	/**
+	 * List the entries in an archive's central directory
+	 * @returns An error message on failure
+	 */
+	static std::optional<std::string> read(
+		unsigned char const* data, size_t size, std::vector<Entry>& entries
+	);
+	/**
+	 * Find where an entry's data starts. This has to look at the
+	 * entry's local header, so it's only done for entries that
+	 * are actually needed
+	 */
+	static std::optional<size_t> getDataOffset(
+		unsigned char const* data, size_t size, Entry const& entry
+	);
+	/**
+	 * Decompress a file's data, starting at its data offset, into
+	 * a buffer of its uncompressed size
+	 */
+	static bool extract(
+		unsigned char const* src, uint16_t method,
+		uint32_t compressedSize, uint32_t size, unsigned char* out
+	);
+};
@@ -8,6 +8,7 @@
 #include <Geode/utils/file.hpp>
 
 #include "../crashlog.hpp"
+#include "../LogSink.hpp"
 #include <Windows.h>
 #include <fstream>
 #include <iostream>
@@ -256,6 +257,9 @@ static void printMods(std::ostream& stream) {
 }
 
 static LONG WINAPI exceptionHandler(LPEXCEPTION_POINTERS info) {
+    // get the logs leading up to the crash onto the disk
+    LogSink::get().flush();
+
     // make sure crashlog directory exists
     (void)utils::file::createDirectoryAll(crashlog::getCrashLogDirectory());
 
@@ -0,0 +1,93 @@
+#include <Geode/loader/Dispatch.hpp>
+#include <Geode/loader/Trace.hpp>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+USE_GEODE_NAMESPACE();
+
+namespace {
+	struct DispatchRegistry {
+		std::mutex m_mutex;
+		std::unordered_map<std::string, size_t> m_ids;
+		// deque so slot addresses never change
+		std::deque<impl::DispatchSlot> m_slots;
+
+		static DispatchRegistry& get() {
+			static auto inst = new DispatchRegistry;
+			return *inst;
+		}
+	};
+
+	void traceRegistryChange(impl::DispatchSlot* slot, Mod* provider, const char* change) {
+		if (!trace::isEnabled()) return;
+		trace::record({
+			.m_name = slot->m_selector.c_str(),
+			.m_category = "dispatch.registry",
+			.m_phase = trace::Phase::Instant,
+			.m_start = trace::now(),
+			.m_mod = provider,
+			.m_detail = change,
+		});
+	}
+}
+
+size_t Dispatcher::getSelectorID(std::string const& selector) {
+	auto& reg = DispatchRegistry::get();
+	std::lock_guard lock(reg.m_mutex);
+	auto it = reg.m_ids.find(selector);
+	if (it != reg.m_ids.end()) {
+		return it->second;
+	}
+	auto id = reg.m_slots.size();
+	reg.m_slots.emplace_back().m_selector = selector;
+	reg.m_ids.insert({ selector, id });
+	return id;
+}
+
+impl::DispatchSlot* Dispatcher::getSlot(size_t id) {
+	auto& reg = DispatchRegistry::get();
+	std::lock_guard lock(reg.m_mutex);
+	if (id < reg.m_slots.size()) {
+		return &reg.m_slots[id];
+	}
+	return nullptr;
+}
+
+void Dispatcher::provide(
+	size_t id, Mod* provider,
+	void* function, std::type_info const& signature
+) {
+	auto slot = Dispatcher::getSlot(id);
+	if (!slot) return;
+	// targets are leaked on purpose; handles compare them by
+	// address, which only works if addresses are never reused
+	auto target = new impl::DispatchTarget { function, &signature, provider };
+	auto& reg = DispatchRegistry::get();
+	std::lock_guard lock(reg.m_mutex);
+	slot->m_target.store(target, std::memory_order_release);
+	traceRegistryChange(slot, provider, "provide");
+}
+
+void Dispatcher::revoke(size_t id) {
+	auto slot = Dispatcher::getSlot(id);
+	if (!slot) return;
+	auto& reg = DispatchRegistry::get();
+	std::lock_guard lock(reg.m_mutex);
+	if (auto target = slot->m_target.load(std::memory_order_relaxed)) {
+		traceRegistryChange(slot, target->m_provider, "revoke");
+		slot->m_target.store(nullptr, std::memory_order_release);
+	}
+}
+
+void Dispatcher::revokeAll(Mod* provider) {
+	auto& reg = DispatchRegistry::get();
+	std::lock_guard lock(reg.m_mutex);
+	for (auto& slot : reg.m_slots) {
+		auto target = slot.m_target.load(std::memory_order_relaxed);
+		if (target && target->m_provider == provider) {
+			traceRegistryChange(&slot, provider, "revoke");
+			slot.m_target.store(nullptr, std::memory_order_release);
+		}
+	}
+}
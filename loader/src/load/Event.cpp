@@ -1,16 +1,172 @@
 #include <Geode/loader/Event.hpp>
-#include <Geode/utils/vector.hpp>
+#include <Geode/loader/Trace.hpp>
+#include <EventRegistry.hpp>
+#include <MPSCQueue.hpp>
+#include <typeindex>
+#include <unordered_map>
 
 USE_GEODE_NAMESPACE();
 
-std::unordered_set<BasicEventHandler*> Event::s_handlers = {};
+namespace {
+	using Registry = EventRegistry<BasicEventHandler, Event>;
+
+	Registry& getRegistry() {
+		// leaked on purpose so static handlers can
+		// still unlisten during static destruction
+		static auto inst = new Registry;
+		return *inst;
+	}
+
+	/**
+	 * Queue nodes that aren't in use. The GD thread pushes nodes
+	 * after posting their events; a producer whose own cache is
+	 * empty takes the whole list at once, which can't run into
+	 * ABA problems like popping single nodes would
+	 */
+	MPSCQueue<impl::QueuedEvent> s_freeNodes;
+
+	struct NodeCache {
+		impl::QueuedEvent* m_nodes = nullptr;
+
+		~NodeCache() {
+			// thread is exiting; give its nodes back
+			while (m_nodes) {
+				auto node = m_nodes;
+				m_nodes = node->m_next;
+				s_freeNodes.push(node);
+			}
+		}
+	};
+
+	thread_local NodeCache t_nodeCache;
+
+	/**
+	 * Events queued through Event::postAsync. Producers push
+	 * to the lock-free queue; the GD thread moves them into
+	 * the backlog, which also holds events that didn't fit
+	 * in the previous frame's time budget
+	 */
+	class EventQueue {
+		MPSCQueue<impl::QueuedEvent> m_incoming;
+		impl::QueuedEvent* m_backlog = nullptr;
+		impl::QueuedEvent* m_backlogTail = nullptr;
+		std::unordered_map<std::type_index, std::unordered_map<size_t, impl::QueuedEvent*>> m_latest;
+
+		void coalesce(impl::QueuedEvent* from) {
+			for (auto ev = from; ev; ev = ev->m_next) {
+				if (!ev->m_mergeType) continue;
+				auto& latest = m_latest[*ev->m_mergeType][ev->m_mergeKey];
+				if (latest) {
+					latest->m_superseded = true;
+				}
+				latest = ev;
+			}
+		}
+
+	public:
+		std::chrono::microseconds m_budget = std::chrono::microseconds(4000);
+
+		static EventQueue& get() {
+			static auto inst = new EventQueue;
+			return *inst;
+		}
+
+		void push(impl::QueuedEvent* ev) {
+			m_incoming.push(ev);
+		}
+
+		void process() {
+			if (auto incoming = m_incoming.popAll()) {
+				if (m_backlogTail) {
+					m_backlogTail->m_next = incoming;
+				} else {
+					m_backlog = incoming;
+				}
+				this->coalesce(incoming);
+				m_backlogTail = incoming;
+				while (m_backlogTail->m_next) {
+					m_backlogTail = m_backlogTail->m_next;
+				}
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			while (m_backlog) {
+				auto ev = m_backlog;
+				m_backlog = ev->m_next;
+				if (!m_backlog) {
+					m_backlogTail = nullptr;
+				}
+				if (ev->m_mergeType) {
+					auto& latest = m_latest[*ev->m_mergeType];
+					if (!ev->m_superseded) {
+						latest.erase(ev->m_mergeKey);
+					}
+				}
+				if (!ev->m_superseded) {
+					ev->m_event->postFrom(ev->m_sender);
+				}
+				impl::QueuedEvent::free(ev);
+
+				if (std::chrono::steady_clock::now() - start >= m_budget) {
+					break;
+				}
+			}
+		}
+	};
+
+	/**
+	 * Records the whole propagation of an event when tracing
+	 */
+	struct EventTraceScope {
+		Event* m_event;
+		bool m_enabled;
+		bool m_stopped = false;
+		uint64_t m_start = 0;
+
+		EventTraceScope(Event* ev, bool enabled) : m_event(ev), m_enabled(enabled) {
+			if (m_enabled) {
+				m_start = trace::now();
+			}
+		}
+		~EventTraceScope() {
+			if (!m_enabled) return;
+			trace::record({
+				.m_name = typeid(*m_event).name(),
+				.m_category = "event",
+				.m_start = m_start,
+				.m_duration = trace::now() - m_start,
+				.m_mod = m_event->getSender(),
+				.m_stopped = m_stopped,
+			});
+		}
+	};
+}
 
 void BasicEventHandler::listen() {
-	Event::s_handlers.insert(this);
+	if (m_listenType) return;
+	m_listenType = &this->getEventType();
+	auto& registry = getRegistry();
+	registry.add(
+		registry.getOrCreateBucket(*m_listenType, this->getEventFilter()),
+		this
+	);
 }
 
 void BasicEventHandler::unlisten() {
-	Event::s_handlers.erase(this);
+	if (!m_listenType) return;
+	auto& registry = getRegistry();
+	if (auto bucket = registry.getBucket(*m_listenType)) {
+		registry.remove(bucket, this);
+	}
+	m_listenType = nullptr;
+}
+
+int BasicEventHandler::getPriority() const {
+	return m_priority;
+}
+
+BasicEventHandler::~BasicEventHandler() {
+	this->unlisten();
 }
 
 Event::~Event() {}
@@ -19,11 +175,27 @@ void Event::postFrom(Mod* m) {
 	if (m)
 		m_sender = m;
 
-	for (auto h : Event::s_handlers) {
-		if (h->passThrough(this) == PassThrough::Stop) {
-			break;
+	auto tracing = trace::isEnabled();
+	EventTraceScope eventTrace(this, tracing);
+
+	getRegistry().dispatch(this, [&](BasicEventHandler* handler) {
+		if (!tracing) {
+			return handler->dispatch(this) == PassThrough::Stop;
 		}
-	}
+		auto start = trace::now();
+		auto stop = handler->dispatch(this) == PassThrough::Stop;
+		trace::record({
+			.m_name = typeid(*handler).name(),
+			.m_category = "event.handler",
+			.m_start = start,
+			.m_duration = trace::now() - start,
+			.m_mod = m_sender,
+			.m_detail = typeid(*this).name(),
+			.m_stopped = stop,
+		});
+		eventTrace.m_stopped = stop;
+		return stop;
+	});
 }
 
 Mod* Event::getSender() {
@@ -31,5 +203,49 @@ Mod* Event::getSender() {
 }
 
 std::unordered_set<BasicEventHandler*> const& Event::getHandlers() {
-	return Event::s_handlers;
+	return getRegistry().getHandlers();
+}
+
+impl::QueuedEvent* impl::QueuedEvent::alloc() {
+	auto& cache = t_nodeCache;
+	if (!cache.m_nodes) {
+		cache.m_nodes = s_freeNodes.popAll();
+	}
+	if (auto node = cache.m_nodes) {
+		cache.m_nodes = node->m_next;
+		node->m_next = nullptr;
+		return node;
+	}
+	return new QueuedEvent;
+}
+
+void impl::QueuedEvent::free(QueuedEvent* node) {
+	if (node->m_inline) {
+		node->m_event->~Event();
+	} else {
+		delete node->m_event;
+	}
+	node->m_event = nullptr;
+	node->m_sender = nullptr;
+	node->m_mergeType = nullptr;
+	node->m_mergeKey = 0;
+	node->m_superseded = false;
+	node->m_inline = false;
+	s_freeNodes.push(node);
+}
+
+void Event::queue(impl::QueuedEvent* ev) {
+	EventQueue::get().push(ev);
+}
+
+void Event::processQueued() {
+	EventQueue::get().process();
+}
+
+void Event::setQueueTimeBudget(std::chrono::microseconds budget) {
+	EventQueue::get().m_budget = budget;
+}
+
+std::chrono::microseconds Event::getQueueTimeBudget() {
+	return EventQueue::get().m_budget;
 }
@@ -2,14 +2,25 @@
 #include <Geode/loader/Mod.hpp>
 #include <Geode/loader/Log.hpp>
 #include <Geode/loader/Loader.hpp>
+#include <Geode/loader/Trace.hpp>
 #include <InternalLoader.hpp>
 #include <InternalMod.hpp>
+#include <LogSink.hpp>
+#include <LoadProfiler.hpp>
+#include <FrameMonitor.hpp>
+#include <ModInfoCache.hpp>
+#include <ArchiveFS.hpp>
+#include <DependencyGraph.hpp>
+#include <FileWriter.hpp>
+#include <WorkerPool.hpp>
 #include <Geode/utils/file.hpp>
 #include <Geode/utils/conststring.hpp>
 #include <Geode/utils/ranges.hpp>
 #include <Geode/utils/map.hpp>
 #include <Geode/utils/types.hpp>
+#include <algorithm>
 #include <mutex>
+#include <unordered_set>
 #include <about.hpp>
 #include <crashlog.hpp>
 
@@ -31,6 +42,7 @@ Loader* Loader::get() {
 }
 
 void Loader::createDirectories() {
+    LoadPhase phase("Loader::createDirectories");
     auto modDir = this->getGeodeDirectory() / GEODE_MOD_DIRECTORY;
     auto logDir = this->getGeodeDirectory() / GEODE_LOG_DIRECTORY;
     auto resDir = this->getGeodeDirectory() / GEODE_RESOURCE_DIRECTORY;
@@ -47,8 +59,6 @@ void Loader::createDirectories() {
         m_modDirectories.push_back(modDir);
     }
 
-    // files too
-    m_logStream = std::ofstream(logDir / log::generateLogName());
 }
 
 void Loader::updateResourcePaths() {
@@ -61,8 +71,16 @@ void Loader::updateResourcePaths() {
         (this->getGeodeDirectory() / GEODE_TEMP_DIRECTORY).string()
     });
 
-    // add mods' search paths
+    // mods' resources are read straight out of their archives
+    // if possible, and from the extracted copies otherwise
+    auto hooked = ArchiveFS::isHooked();
     for (auto const& [_, mod] : m_mods) {
+        if (hooked && mod->m_info.m_path.extension() == ".geode") {
+            auto res = ArchiveFS::get().mount(mod->m_info.m_path);
+            if (res) continue;
+            log::log(Severity::Debug, mod, "Using extracted resources: {}", res.error());
+        }
+
         auto searchPath = this->getGeodeDirectory() / 
             GEODE_TEMP_DIRECTORY / mod->getID() / "resources";
         
@@ -74,6 +92,7 @@ void Loader::updateResourcePaths() {
     for (auto const& path : m_texturePaths) {
         CCFileUtils::get()->addSearchPath(path.string().c_str());
     }
+    ArchiveFS::get().setOverriddenPaths(m_texturePaths);
 }
 
 void Loader::updateModResources(Mod* mod) {
@@ -110,6 +129,7 @@ void Loader::updateModResources(Mod* mod) {
 }
 
 void Loader::updateResources() {
+    LoadPhase phase("Loader::updateResources");
     log::debug("Adding resources");
 
     this->updateResourcePaths();
@@ -135,58 +155,97 @@ size_t Loader::loadModsFromDirectory(
     ghc::filesystem::path const& dir, bool recursive
 ) {
     log::debug("Searching {}", dir);
-        
-    size_t loadedCount = 0;
-    for (auto const& entry : ghc::filesystem::directory_iterator(dir)) {
-        // recursively search directories
-        if (ghc::filesystem::is_directory(entry) && recursive) {
-            loadedCount += this->loadModsFromDirectory(entry.path(), true);
-            continue;
-        }
 
-        // skip this entry if it's not a file
-        if (!ghc::filesystem::is_regular_file(entry)) {
-            continue;
-        }
+    // already loaded mods are skipped
+    std::unordered_set<std::string> loadedPaths;
+    for (auto const& [_, mod] : m_mods) {
+        loadedPaths.insert(mod->m_info.m_path.string());
+    }
 
-        // skip this entry if its extension is not .geode 
-        if (entry.path().extension() != GEODE_MOD_EXTENSION) {
-            continue;
+    std::vector<ghc::filesystem::path> found;
+    auto check = [&](ghc::filesystem::directory_entry const& entry) {
+        if (
+            ghc::filesystem::is_regular_file(entry) &&
+            entry.path().extension() == GEODE_MOD_EXTENSION &&
+            !loadedPaths.count(entry.path().string())
+        ) {
+            found.push_back(entry.path());
+        }
+    };
+    if (recursive) {
+        for (auto const& entry : ghc::filesystem::recursive_directory_iterator(dir)) {
+            check(entry);
         }
+    } else {
+        for (auto const& entry : ghc::filesystem::directory_iterator(dir)) {
+            check(entry);
+        }
+    }
 
-        // skip this entry if it's already loaded
-        if (utils::map::contains<std::string, Mod*>(
-            m_mods,
-            [entry](Mod* p) -> bool {
-                return p->m_info.m_path == entry.path();
-            }
-        )) continue;
+    // opening the archives and parsing mod.json doesn't touch
+    // the loader, so it's spread over the worker threads
+    struct Parsed {
+        std::optional<Result<ModInfo>> m_info;
+        uint64_t m_start = 0;
+        uint64_t m_duration = 0;
+    };
+    std::vector<Parsed> parsed(found.size());
+    WorkerPool::get().forEach(found.size(), [&](size_t i) {
+        auto& res = parsed[i];
+        res.m_start = trace::now();
+        res.m_info.emplace(ModInfo::createFromGeodeFile(found[i]));
+        res.m_duration = trace::now() - res.m_start;
+        if (trace::isCapturing()) {
+            trace::record({
+                .m_name = "ModInfo::createFromGeodeFile",
+                .m_category = "startup",
+                .m_start = res.m_start,
+                .m_duration = res.m_duration,
+            });
+        }
+    });
 
-        // load mod
+    // registering mods happens in order on this thread
+    std::vector<Mod*> registered;
+    for (size_t i = 0; i < found.size(); i++) {
+        auto& path = found[i];
+        auto& info = parsed[i].m_info.value();
 
-        log::debug("Loading {}", entry.path().string());
+        log::debug("Loading {}", path.string());
 
-        auto res = this->loadModFromFile(entry.path().string());
+        auto res = info ?
+            this->loadModFromInfo(info.value()) :
+            Result<Mod*>(Err(info.error()));
         if (res && res.value()) {
-            // succesfully loaded
-            loadedCount++;
-
-            // check for dependencies
-            if (!res.value()->hasUnresolvedDependencies()) {
-                log::debug("Successfully loaded {}", res.value());
-            } else {
-                log::error("{} has unresolved dependencies", res.value());
-            }
+            registered.push_back(res.value());
+            // parsing was already traced on the thread that did it
+            LoadProfiler::get().add(
+                "ModInfo::createFromGeodeFile", res.value(),
+                parsed[i].m_start, parsed[i].m_duration, false
+            );
         } else {
             // something went wrong
             log::error("{}", res.error());
-            m_erroredMods.push_back({ entry.path().string(), res.error() });
+            m_erroredMods.push_back({ path.string(), res.error() });
         }
     }
-    return loadedCount;
+
+    // dependencies are only resolved once everything is in, so
+    // each mod gets loaded once and in the right order
+    this->updateAllDependencies();
+
+    for (auto mod : registered) {
+        if (!mod->hasUnresolvedDependencies()) {
+            log::debug("Successfully loaded {}", mod);
+        } else {
+            log::error("{} has unresolved dependencies", mod);
+        }
+    }
+    return registered.size();
 }
 
 size_t Loader::refreshMods() {
+    LoadPhase phase("Loader::refreshMods");
     log::debug("Loading mods...");
     
     // clear errored mods since that list will be 
@@ -205,18 +264,48 @@ size_t Loader::refreshMods() {
     }
 
     log::debug("Loaded {} mods", loadedCount);
+
+    auto cache = ModInfoCache::get().save(this->getGeodeSaveDirectory() / "mod-info-cache.json");
+    if (cache) {
+        log::warn("Unable to save mod info cache: {}", cache.value());
+    }
     return loadedCount;
 }
 
+namespace {
+    std::optional<Severity::type> severityFromString(std::string const& str) {
+        for (int i = Severity::Debug; i <= Severity::Emergency; i++) {
+            if (str == Severity::toString(Severity::cast(i))) {
+                return Severity::cast(i);
+            }
+        }
+        return std::nullopt;
+    }
+}
+
 Result<> Loader::saveSettings() {
     auto json = nlohmann::json::object();
 
+    json["log-level"] = Severity::toString(log::getLogLevel().m_value);
+    json["binary-logs"] = m_loadedSettings.m_binaryLogs;
+    json["frame-budget-ms"] = m_loadedSettings.m_frameBudget;
+    auto& retention = m_loadedSettings.m_logRetention;
+    json["log-retention"] = {
+        { "max-files", retention.m_maxFiles },
+        { "max-bytes", retention.m_maxBytes },
+        { "max-age-days", retention.m_maxAge.count() / 24 },
+        { "compress", retention.m_compress },
+    };
+
     // save mod enabled / disabled states
     json["mods"] = nlohmann::json::object();
     for (auto [id, mod] : m_mods) {
         if (mod->isUninstalled()) continue;
         auto value = nlohmann::json::object();
         value["enabled"] = mod->m_enabled;
+        if (mod->m_logLevelOverride) {
+            value["log-level"] = Severity::toString(mod->m_logLevelOverride.value());
+        }
 
         // save mod's settings
         auto saveSett = mod->saveSettings();
@@ -239,13 +328,17 @@ Result<> Loader::saveSettings() {
     // mark the game as not having crashed
     json["succesfully-closed"] = true;
 
-    return utils::file::writeString(
-        this->getGeodeSaveDirectory() / "mods.json",
-        json.dump(4)
-    );
+    FileWriter::get().write(this->getGeodeSaveDirectory() / "mods.json", json.dump());
+    // written right away, so failing to write anything queued so
+    // far can be reported
+    if (auto error = FileWriter::get().flush()) {
+        return Err("Unable to save: " + error.value());
+    }
+    return Ok();
 }
 
 Result<> Loader::loadSettings() {
+    LoadPhase phase("Loader::loadSettings");
     auto path = this->getGeodeSaveDirectory() / "mods.json";
     if (!ghc::filesystem::exists(path)) {
         return Ok();
@@ -258,6 +351,57 @@ Result<> Loader::loadSettings() {
     }
     try {
         auto json = nlohmann::json::parse(read.value());
+        if (json.contains("log-level")) {
+            auto level = json["log-level"].is_string() ?
+                severityFromString(json["log-level"]) :
+                std::nullopt;
+            if (!level) {
+                return Err("[loader settings].log-level is not a valid severity");
+            }
+            log::setLogLevel(level.value());
+        }
+        if (json.contains("binary-logs")) {
+            if (!json["binary-logs"].is_boolean()) {
+                return Err("[loader settings].binary-logs is not a boolean");
+            }
+            m_loadedSettings.m_binaryLogs = json["binary-logs"];
+        }
+        if (json.contains("frame-budget-ms")) {
+            if (!json["frame-budget-ms"].is_number_unsigned()) {
+                return Err("[loader settings].frame-budget-ms is not a positive number");
+            }
+            m_loadedSettings.m_frameBudget = json["frame-budget-ms"];
+        }
+        if (json.contains("log-retention")) {
+            auto retention = json["log-retention"];
+            if (!retention.is_object()) {
+                return Err("[loader settings].log-retention is not an object");
+            }
+            auto& policy = m_loadedSettings.m_logRetention;
+            for (auto key : { "max-files", "max-bytes", "max-age-days" }) {
+                if (retention.contains(key) && !retention[key].is_number_unsigned()) {
+                    return Err(
+                        "[loader settings].log-retention." + std::string(key) +
+                        " is not a positive number"
+                    );
+                }
+            }
+            if (retention.contains("max-files")) {
+                policy.m_maxFiles = retention["max-files"];
+            }
+            if (retention.contains("max-bytes")) {
+                policy.m_maxBytes = retention["max-bytes"];
+            }
+            if (retention.contains("max-age-days")) {
+                policy.m_maxAge = std::chrono::hours(24 * retention["max-age-days"].get<size_t>());
+            }
+            if (retention.contains("compress")) {
+                if (!retention["compress"].is_boolean()) {
+                    return Err("[loader settings].log-retention.compress is not a boolean");
+                }
+                policy.m_compress = retention["compress"];
+            }
+        }
         if (json.contains("mods")) {
             auto mods = json["mods"];
             if (!mods.is_object()) {
@@ -280,6 +424,18 @@ Result<> Loader::loadSettings() {
                     }
                     mod.m_enabled = val["enabled"];
                 }
+                if (val.contains("log-level")) {
+                    auto level = val["log-level"].is_string() ?
+                        severityFromString(val["log-level"]) :
+                        std::nullopt;
+                    if (!level) {
+                        return Err(
+                            "[loader settings].mods.\"" + key +
+                            "\".log-level is not a valid severity"
+                        );
+                    }
+                    mod.m_logLevel = level;
+                }
                 m_loadedSettings.m_mods.insert({ key, mod });
             }
         }
@@ -338,14 +494,105 @@ std::vector<Loader::FailedModInfo> Loader::getFailedMods() const {
     return m_erroredMods;
 }
 
-void Loader::updateAllDependencies() {
+std::vector<std::vector<Mod*>> Loader::getDependencyLayers(std::vector<Mod*>& cyclic) const {
+    // sorted so the order doesn't depend on the map's
+    auto mods = this->getAllMods();
+    std::sort(mods.begin(), mods.end(), [](Mod* a, Mod* b) {
+        return a->m_info.m_id < b->m_info.m_id;
+    });
+    std::vector<DependencyGraph::Node> nodes(mods.size());
+    for (size_t i = 0; i < mods.size(); i++) {
+        nodes[i].m_id = mods[i]->m_info.m_id;
+        for (auto const& dep : mods[i]->m_info.m_dependencies) {
+            nodes[i].m_dependencies.push_back({ dep.m_id, dep.m_required });
+        }
+    }
+
+    std::vector<size_t> stuck;
+    std::vector<std::vector<Mod*>> layers;
+    for (auto const& indices : DependencyGraph::sortIntoLayers(nodes, stuck)) {
+        auto& layer = layers.emplace_back();
+        for (auto i : indices) {
+            layer.push_back(mods[i]);
+        }
+    }
+    for (auto i : stuck) {
+        cyclic.push_back(mods[i]);
+    }
+    return layers;
+}
+
+void Loader::markDeferredMods() {
     for (auto const& [_, mod] : m_mods) {
+        mod->m_deferred = mod->m_info.m_deferLoad && mod->m_enabled && !mod->m_loaded;
+    }
+    // anything a mod loaded at startup depends on has to be there
+    // when it loads, whatever it asked for
+    std::vector<Mod*> needed;
+    for (auto const& [_, mod] : m_mods) {
+        if (mod->m_enabled && !mod->m_deferred) {
+            needed.push_back(mod);
+        }
+    }
+    while (needed.size()) {
+        auto mod = needed.back();
+        needed.pop_back();
+        for (auto const& dep : mod->m_info.m_dependencies) {
+            auto it = m_mods.find(dep.m_id);
+            if (it != m_mods.end() && it->second->m_deferred) {
+                it->second->m_deferred = false;
+                needed.push_back(it->second);
+            }
+        }
+    }
+}
+
+void Loader::updateAllDependencies() {
+    // loading and unloading mods below comes back here; the
+    // mods that affects are visited later anyway
+    if (m_resolvingDependencies) return;
+    m_resolvingDependencies = true;
+
+    if (m_deferringMods) {
+        this->markDeferredMods();
+    }
+
+    std::vector<Mod*> cyclic;
+    auto layers = this->getDependencyLayers(cyclic);
+    for (auto const& layer : layers) {
+        // deferred mods are left as they are until their turn
+        // comes after the main menu
+        std::vector<Mod*> updating;
+        for (auto mod : layer) {
+            if (!mod->m_deferred) {
+                updating.push_back(mod);
+            }
+        }
+        // mods in a layer don't depend on each other, so their
+        // binaries can be loaded side by side
+        InternalLoader::get()->loadBinariesAhead(updating);
+        for (auto mod : updating) {
+            mod->updateDependencyStates();
+        }
+        InternalLoader::get()->discardBinariesAhead();
+    }
+    for (auto mod : cyclic) {
+        log::log(Severity::Error, mod, "Mod is part of a dependency cycle, or depends on one");
+        // would never load anyway
+        mod->m_deferred = false;
+        // the rest of the cycle never gets loaded, so this
+        // leaves it unresolved
         mod->updateDependencyStates();
     }
+
+    m_resolvingDependencies = false;
 }
 
 void Loader::unloadMod(Mod* mod) {
     m_mods.erase(mod->m_info.m_id);
+    ArchiveFS::get().unmount(mod->m_info.m_path);
+    trace::forgetMod(mod);
+    LogSink::get().prepareUnload();
     // ~Mod will call FreeLibrary 
     // automatically
     delete mod;
@@ -355,6 +602,8 @@ bool Loader::setup() {
     if (m_isSetup)
         return true;
 
+    LoadPhase phase("Loader::setup");
+
     if (crashlog::setupPlatformHandler()) {
         log::debug("Set up platform crash logger");
     } else {
@@ -364,12 +613,41 @@ bool Loader::setup() {
     log::debug("Setting up Loader...");
 
     this->createDirectories();
+    FileWriter::get().setErrorHandler([](std::string const& error) {
+        log::warn("Unable to save: {}", error);
+    });
     auto sett = this->loadSettings();
     if (!sett) {
         log::warn("Unable to load loader settings: {}", sett.error());
     }
+
+    // started after loading settings so the format is known;
+    // anything logged before is kept until then
+    auto logFile = this->getGeodeDirectory() / GEODE_LOG_DIRECTORY / log::generateLogName();
+    if (m_loadedSettings.m_binaryLogs) {
+        logFile.replace_extension(".glog");
+    }
+    LogSink::get().start(logFile, m_loadedSettings.m_binaryLogs, m_loadedSettings.m_logRetention);
+
+    ModInfoCache::get().load(
+        this->getGeodeSaveDirectory() / "mod-info-cache.json", LOADER_VERSION_STR
+    );
     this->refreshMods();
 
+    // extracted mods are kept between launches, but not once the
+    // mod is gone. Done here since the loader is never destroyed
+    auto tempDir = this->getGeodeDirectory() / GEODE_TEMP_DIRECTORY;
+    std::error_code ec;
+    for (auto const& entry : ghc::filesystem::directory_iterator(tempDir, ec)) {
+        auto id = entry.path().filename().string();
+        if (id.ends_with(".manifest.json")) {
+            id = id.substr(0, id.size() - std::string_view(".manifest.json").size());
+        }
+        if (!m_mods.count(id)) {
+            ghc::filesystem::remove_all(entry.path(), ec);
+        }
+    }
+
     m_isSetup = true;
 
     return true;
@@ -385,35 +663,56 @@ Loader::~Loader() {
     m_mods.clear();
     m_logs.clear();
 
-    auto tempDir = this->getGeodeDirectory() / GEODE_TEMP_DIRECTORY;
-    ghc::filesystem::remove_all(tempDir);
+    FileWriter::get().stop();
+    LogSink::get().stop();
 }
 
 void Loader::pushLog(log::Log&& log) {
-    std::string logStr = log.toString(true);
-
-    InternalLoader::get()->logConsoleMessage(logStr);
-    m_logStream << logStr << std::endl;
-
-    m_logs.push_back(std::move(log));
+    // the sink does the actual writing on its own thread, and
+    // adds the log to the store once it's written
+    log::LogRecord record;
+    record.m_time = log.getTime();
+    record.m_severity = static_cast<uint8_t>(log.getSeverity().m_value);
+    record.m_format = "{}";
+    record.putString(log.getMessage());
+    log::vlogImpl(log.getSender(), record);
 }
 
 void Loader::popLog(log::Log* log) {
-    ranges::remove(m_logs, *log);
+    m_logs.remove(*log);
 }
 
-std::vector<log::Log*> Loader::getLogs(
+std::vector<log::Log> Loader::getLogs(
     std::initializer_list<Severity> severityFilter
 ) {
-    std::vector<log::Log*> logs;
+    return m_logs.getLogs(severityFilter);
+}
 
-    for (auto& log : m_logs) {
-        if (ranges::contains(severityFilter, log.getSeverity()) || !severityFilter.size()) {
-            logs.push_back(&log);
-        }
-    }
+std::vector<log::Log> Loader::getModLogs(
+    Mod* mod, std::initializer_list<Severity> severityFilter
+) {
+    return m_logs.getModLogs(mod, severityFilter);
+}
+
+void Loader::setBinaryLogs(bool binary) {
+    m_loadedSettings.m_binaryLogs = binary;
+}
+
+bool Loader::isUsingBinaryLogs() const {
+    return m_loadedSettings.m_binaryLogs;
+}
 
-    return logs;
+void Loader::setFrameBudget(uint32_t milliseconds) {
+    m_loadedSettings.m_frameBudget = milliseconds;
+    FrameMonitor::get().setBudget(milliseconds);
+}
+
+uint32_t Loader::getFrameBudget() const {
+    return m_loadedSettings.m_frameBudget;
+}
+
+log::LogStore& Loader::getLogStore() {
+    return m_logs;
 }
 
 void Loader::clearLogs() {
@@ -421,7 +720,11 @@ void Loader::clearLogs() {
 }
 
 void Loader::queueInGDThread(ScheduledFunction func) {
-    InternalLoader::get()->queueInGDThread(func);
+    InternalLoader::get()->queueInGDThread(std::move(func));
+}
+
+void Loader::queueInGDThread(ScheduledFunction func, void const* key) {
+    InternalLoader::get()->queueInGDThread(std::move(func), key);
 }
 
 Mod* Loader::getInternalMod() {
@@ -487,6 +790,10 @@ void Loader::closePlatfromConsole() {
 
 void Loader::scheduleOnModLoad(Mod* m, ScheduledFunction func) {
     if (m) return func();
+    // binaries loaded on a worker thread keep theirs apart
+    if (auto capture = InternalLoader::getScheduleCapture()) {
+        return capture->m_functions.push_back(func);
+    }
     m_scheduledFunctions.push_back(func);
 }
 
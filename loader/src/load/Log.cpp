@@ -4,8 +4,11 @@
 #include <Geode/utils/general.hpp>
 #include <Geode/utils/casts.hpp>
 #include <InternalLoader.hpp>
+#include <InternalMod.hpp>
+#include <LogSink.hpp>
 #include <fmt/format.h>
 #include <fmt/chrono.h>
+#include <Geode/utils/ranges.hpp>
 #include <iomanip>
 
 USE_GEODE_NAMESPACE();
@@ -17,6 +20,14 @@ std::vector<std::function<void(Mod*)>>& Log::scheduled() {
     return ret;
 }
 
+void Log::schedule(std::function<void(Mod*)> func) {
+    // binaries loaded on a worker thread keep theirs apart
+    if (auto capture = InternalLoader::getScheduleCapture()) {
+        return capture->m_logs.push_back(func);
+    }
+    Log::scheduled().push_back(func);
+}
+
 void log::releaseSchedules(Mod* m) {
     for (auto& func : Log::scheduled()) {
         func(m);
@@ -85,7 +96,25 @@ std::string log::parse(cocos2d::ccColor4B const& col) {
     return fmt::format("rgba({}, {}, {}, {})", col.r, col.g, col.b, col.a);
 }
 
-Log::Log(Mod* mod, Severity sev) : m_sender(mod), m_time(log_clock::now()), m_severity(sev) {}
+Log::Log(Mod* mod, Severity sev, std::string message)
+  : Log(mod, sev, std::move(message), log_clock::now()) {}
+
+Log::Log(Mod* mod, Severity sev, std::string message, log_clock::time_point time)
+  : m_sender(mod), m_time(time),
+    m_message(std::move(message)), m_severity(sev) {}
+
+Log::Log(
+    Mod* mod, Severity sev, log_clock::time_point time,
+    std::string_view format, std::string args
+) : m_sender(mod), m_time(time), m_severity(sev),
+    m_format(format), m_args(std::move(args)) {}
+
+void Log::render() {
+    if (m_format.empty()) return;
+    renderLog(m_message, m_format, m_args);
+    m_format = {};
+    m_args = {};
+}
 
 bool Log::operator==(Log const& l) {
     return this == &l;
@@ -100,9 +129,7 @@ std::string Log::toString(bool logTime) const {
 
     res += fmt::format(" [{}]: ", m_sender ? m_sender->getName() : "?");
 
-    for (auto& i : m_components) {
-        res += i->_toString();
-    }
+    res += m_message;
 
     return res;
 }
@@ -111,65 +138,278 @@ void Log::pushToLoader() {
     Loader::get()->pushLog(std::move(*this));
 }
 
+namespace {
+    std::atomic<Severity::type>& globalLogLevel() {
+    #ifdef GEODE_DEBUG
+        static std::atomic<Severity::type> level = Severity::Debug;
+    #else
+        static std::atomic<Severity::type> level = Severity::Info;
+    #endif
+        return level;
+    }
+}
+
+Severity log::getLogLevel() {
+    return globalLogLevel().load(std::memory_order_relaxed);
+}
+
+void log::setLogLevel(Severity level) {
+    globalLogLevel().store(level.m_value, std::memory_order_relaxed);
+    // refresh the mods that follow the global level
+    for (auto mod : Loader::get()->getAllMods()) {
+        mod->setLogLevel(mod->getLogLevelOverride());
+    }
+    auto internal = InternalMod::get();
+    internal->setLogLevel(internal->getLogLevelOverride());
+}
+
 std::string geode::log::generateLogName() {
     return fmt::format("Geode {:%d %b %H.%M.%S}.log", log_clock::now());
 }
 
-void geode::log::vlogImpl(Severity severity, Mod* mod, std::string_view formatStr, std::function<void(Log&)>* components, size_t componentsSize) {
-    Log log(mod, severity);
+static_assert(LogSink::SEVERE == Severity::Error);
+
+namespace {
+    /**
+     * Looked up once per mod per thread, and again after a mod
+     * is unloaded since another may then have the same address
+     */
+    LogSender const* getSender(Mod* mod) {
+        if (!mod) return nullptr;
+        static thread_local std::unordered_map<Mod*, LogSender const*> cache;
+        static thread_local size_t cacheGeneration = 0;
+        auto& sink = LogSink::get();
+        auto generation = sink.getSenderGeneration();
+        if (generation != cacheGeneration) {
+            cache.clear();
+            cacheGeneration = generation;
+        }
+        auto& sender = cache[mod];
+        if (!sender) {
+            sender = sink.getSender(mod->getID(), mod->getName());
+        }
+        return sender;
+    }
+}
 
-    const auto pushSomething = [](Log& log, auto something) {
-        // i think this line of code is very sad
-        log.getComponents().push_back(new ComponentBase(something));
-    };
+void geode::log::vlogImpl(Mod* mod, LogRecord& record) {
+    // records made from a Log already have its time
+    if (record.m_time == log_clock::time_point()) {
+        record.m_time = log_clock::now();
+    }
+    record.m_mod = mod;
+    record.m_sender = getSender(mod);
+    LogSink::get().push(std::move(record));
+}
 
-    size_t compIndex = 0;
-    std::string current;
-    for (size_t i = 0; i < formatStr.size(); ++i) {
-        if (formatStr[i] == '{') {
-            if (i == formatStr.size() - 1)
-                throw std::runtime_error("Unescaped { at the end of format string");
-            const auto next = formatStr[i + 1];
-            if (next == '{') {
-                current.push_back('{');
-                ++i;
-                continue;
-            }
-            if (next == '}') {
-                if (compIndex >= componentsSize)
-                    throw std::runtime_error("Not enough arguments for format string");
-                pushSomething(log, current);
-                components[compIndex++](log);
-                current.clear();
-                ++i;
-                continue;
-            }
-            throw std::runtime_error("You put something in between {} silly head");
+LogRing::LogRing(size_t capacity) : m_capacity(capacity) {
+    m_logs.reserve(capacity);
+    m_removed.reserve(capacity);
+}
+
+void LogRing::push(Log&& log) {
+    if (m_logs.size() < m_capacity) {
+        m_logs.push_back(std::move(log));
+        m_removed.push_back(false);
+    } else {
+        auto index = m_pushed % m_capacity;
+        m_logs[index] = std::move(log);
+        m_removed[index] = false;
+    }
+    m_pushed++;
+}
+
+uint64_t LogRing::find(uint64_t order) const {
+    // logs are pushed in order, so a ring's orders only go up
+    auto first = this->getFirstSeq();
+    auto last = m_pushed;
+    while (first < last) {
+        auto mid = first + (last - first) / 2;
+        if (this->getOrder(mid) < order) {
+            first = mid + 1;
+        } else {
+            last = mid;
         }
-        if (formatStr[i] == '}') {
-            if (i == formatStr.size() - 1)
-                throw std::runtime_error("Unescaped } at the end of format string");
-            if (formatStr[i + 1] == '}') {
-                current.push_back('}');
-                ++i;
-                continue;
+    }
+    if (first < m_pushed && this->getOrder(first) == order) {
+        return first;
+    }
+    return m_pushed;
+}
+
+uint64_t LogRing::setCapacity(size_t capacity) {
+    auto keep = std::min(m_logs.size(), capacity);
+    auto first = m_pushed - keep;
+
+    LogRing resized(capacity);
+    for (auto seq = first; seq < m_pushed; seq++) {
+        resized.push(std::move(*this->at(seq)));
+        resized.m_removed.back() = this->isRemoved(seq);
+    }
+    *this = std::move(resized);
+    return first;
+}
+
+LogStore::LogStore() {
+    m_rings[Severity::Debug] = LogRing(1000);
+    m_rings[Severity::Info] = LogRing(2000);
+    m_rings[Severity::Notice] = LogRing(1000);
+    m_rings[Severity::Warning] = LogRing(1000);
+    m_rings[Severity::Error] = LogRing(1000);
+    m_rings[Severity::Critical] = LogRing(200);
+    m_rings[Severity::Alert] = LogRing(200);
+    m_rings[Severity::Emergency] = LogRing(200);
+}
+
+void LogStore::push(Log&& log) {
+    std::lock_guard lock(m_mutex);
+    auto sev = log.getSeverity().m_value;
+    auto& ring = m_rings[sev];
+    if (!ring.getCapacity()) return;
+
+    // the oldest log of this severity is about to be overwritten,
+    // and it's also the oldest of its mod's logs of this severity
+    if (ring.size() == ring.getCapacity()) {
+        auto first = ring.getFirstSeq();
+        auto it = m_modIndex.find(ring.at(first)->getSender());
+        if (it != m_modIndex.end()) {
+            auto& index = it->second[sev];
+            if (index.size() && index.front() == first) {
+                index.pop_front();
             }
-            throw std::runtime_error("You have an unescaped }");
         }
+    }
+
+    auto sender = log.getSender();
+    auto seq = ring.getEndSeq();
+    log.m_order = m_nextOrder++;
+    ring.push(std::move(log));
+    m_modIndex[sender][sev].push_back(seq);
+}
+
+void LogStore::remove(Log const& log) {
+    std::lock_guard lock(m_mutex);
+    auto& ring = m_rings[log.getSeverity().m_value];
+    auto seq = ring.find(log.m_order);
+    if (seq != ring.getEndSeq()) {
+        ring.m_removed[seq % ring.m_capacity] = true;
+    }
+}
 
-        current.push_back(formatStr[i]);
+void LogStore::clear() {
+    std::lock_guard lock(m_mutex);
+    for (auto& ring : m_rings) {
+        ring = LogRing(ring.getCapacity());
     }
+    m_modIndex.clear();
+}
 
-    if (!current.empty())
-        pushSomething(log, current);
+void LogStore::setCapacity(Severity severity, size_t capacity) {
+    std::lock_guard lock(m_mutex);
+    auto sev = severity.m_value;
+    auto offset = m_rings[sev].setCapacity(capacity);
+    for (auto& [_, indices] : m_modIndex) {
+        auto& index = indices[sev];
+        while (index.size() && index.front() < offset) {
+            index.pop_front();
+        }
+        for (auto& seq : index) {
+            seq -= offset;
+        }
+    }
+}
+
+size_t LogStore::getCapacity(Severity severity) const {
+    std::lock_guard lock(m_mutex);
+    return m_rings[severity.m_value].getCapacity();
+}
 
-    if (compIndex != componentsSize) {
-        throw std::runtime_error("You have left over arguments.. silly head");
-        // show_silly_error(formatStr);
+namespace {
+    /**
+     * Merge per-severity runs of logs back into the order they
+     * were logged in. There are at most a handful of runs, so
+     * picking the oldest head each time is cheap
+     */
+    template <class Run>
+    std::vector<Log*> mergeRuns(std::vector<Run>& runs) {
+        std::vector<Log*> res;
+        while (true) {
+            Run* oldest = nullptr;
+            uint64_t oldestOrder = 0;
+            for (auto& run : runs) {
+                if (run.done()) continue;
+                auto order = run.m_ring->getOrder(run.seq());
+                if (!oldest || order < oldestOrder) {
+                    oldest = &run;
+                    oldestOrder = order;
+                }
+            }
+            if (!oldest) break;
+            if (!oldest->m_ring->isRemoved(oldest->seq())) {
+                res.push_back(oldest->m_ring->at(oldest->seq()));
+            }
+            oldest->next();
+        }
+        return res;
     }
 
-    // (l.getComponents().push_back(new ComponentBase(args)), ...);
+    struct RingRun {
+        LogRing* m_ring;
+        uint64_t m_seq;
+
+        bool done() const { return m_seq >= m_ring->getEndSeq(); }
+        uint64_t seq() const { return m_seq; }
+        void next() { m_seq++; }
+    };
+
+    struct IndexRun {
+        LogRing* m_ring;
+        std::deque<uint64_t>::const_iterator m_it;
+        std::deque<uint64_t>::const_iterator m_end;
+
+        bool done() const { return m_it == m_end; }
+        uint64_t seq() const { return *m_it; }
+        void next() { ++m_it; }
+    };
+}
+
+std::vector<Log> LogStore::copyLogs(std::vector<Log*> const& logs) {
+    std::vector<Log> res;
+    res.reserve(logs.size());
+    for (auto log : logs) {
+        log->render();
+        res.push_back(*log);
+    }
+    return res;
+}
 
-    log.pushToLoader();
+std::vector<Log> LogStore::getLogs(std::initializer_list<Severity> severityFilter) {
+    std::lock_guard lock(m_mutex);
+    std::vector<RingRun> runs;
+    for (size_t sev = 0; sev < SEVERITY_COUNT; sev++) {
+        if (severityFilter.size() && !ranges::contains(severityFilter, Severity::cast(sev))) {
+            continue;
+        }
+        runs.push_back({ &m_rings[sev], m_rings[sev].getFirstSeq() });
+    }
+    return copyLogs(mergeRuns(runs));
 }
 
+std::vector<Log> LogStore::getModLogs(
+    Mod* mod, std::initializer_list<Severity> severityFilter
+) {
+    std::lock_guard lock(m_mutex);
+    auto it = m_modIndex.find(mod);
+    if (it == m_modIndex.end()) {
+        return {};
+    }
+    std::vector<IndexRun> runs;
+    for (size_t sev = 0; sev < SEVERITY_COUNT; sev++) {
+        if (severityFilter.size() && !ranges::contains(severityFilter, Severity::cast(sev))) {
+            continue;
+        }
+        auto& index = it->second[sev];
+        runs.push_back({ &m_rings[sev], index.begin(), index.end() });
+    }
+    return copyLogs(mergeRuns(runs));
+}
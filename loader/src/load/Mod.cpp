@@ -1,4 +1,5 @@
 #include <about.hpp>
+#include <Geode/loader/Dispatch.hpp>
 #include <Geode/loader/Hook.hpp>
 #include <Geode/loader/Loader.hpp>
 #include <Geode/loader/Log.hpp>
@@ -11,39 +12,50 @@
 #include <Geode/utils/string.hpp>
 #include <Geode/utils/vector.hpp>
 #include <Geode/utils/ranges.hpp>
+#include <InternalLoader.hpp>
 #include <InternalMod.hpp>
+#include <ArchiveFS.hpp>
+#include <FileWriter.hpp>
+#include <LoadProfiler.hpp>
 #include <../support/zip_support/ZipUtils.h>
 
 USE_GEODE_NAMESPACE();
 
-nlohmann::json& DataStore::operator[](std::string const& key) {
-    return m_mod->m_dataStore[key];
+DataStore::DataStore(Mod* m) : m_mod(m), m_generation(m->m_dataStoreGeneration) {}
+
+TrackedJson DataStore::operator[](std::string const& key) const {
+    return this->getJson()[key];
 }
 
-DataStore& DataStore::operator=(nlohmann::json& jsn) {
+DataStore& DataStore::operator=(nlohmann::json const& jsn) {
+    m_mod->m_dataStoreGeneration++;
     m_mod->m_dataStore = jsn;
     return *this;
 }
 
-nlohmann::json& DataStore::getJson() const {
-    return m_mod->m_dataStore;
+TrackedJson DataStore::getJson() const {
+    return TrackedJson(m_mod->m_dataStore, m_mod->m_dataStoreGeneration);
+}
+
+nlohmann::json const& DataStore::at(std::string const& key) const {
+    return m_mod->m_dataStore.at(key);
 }
 
 bool DataStore::contains(std::string const& key) const {
     return m_mod->m_dataStore.contains(key);
 }
 
-DataStore::operator nlohmann::json() {
+DataStore::operator nlohmann::json() const {
     return m_mod->m_dataStore;
 }
 
 DataStore::~DataStore() {
-    if (m_store != m_mod->m_dataStore) {
+    if (m_generation != m_mod->m_dataStoreGeneration) {
         m_mod->postDSUpdate();
     }
 }
 
-Mod::Mod(ModInfo const& info) {
+Mod::Mod(ModInfo const& info) : m_logLevel(log::getLogLevel().m_value) {
     m_info = info;
 }
 
@@ -54,6 +66,11 @@ Mod::~Mod() {
 Result<> Mod::loadSettings() {
     // settings
 
+    // settings.json is rewritten if it's missing settings or
+    // has ones the mod doesn't have anymore
+    size_t loadedCount = 0;
+    m_settingsDirty = false;
+
     // Check if settings exist
     auto settPath = m_saveDirPath / "settings.json";
     if (ghc::filesystem::exists(settPath)) {
@@ -75,7 +92,9 @@ Result<> Mod::loadSettings() {
                             key + "\""
                         );
                     }
+                    loadedCount++;
                 } else {
+                    m_settingsDirty = true;
                     log::log(
                         Severity::Warning,
                         this, 
@@ -89,16 +108,21 @@ Result<> Mod::loadSettings() {
             return Err(std::string("Unable to parse settings: ") + e.what());
         }
     }
+    if (loadedCount < m_info.m_settings.size()) {
+        m_settingsDirty = true;
+    }
 
     // datastore
     auto dsPath = m_saveDirPath / "ds.json";
     if (!ghc::filesystem::exists(dsPath)) {
         m_dataStore = m_info.m_defaultDataStore;
+        m_dataStoreDirty = true;
     } else {
         auto dsData = utils::file::readString(dsPath);
         if (!dsData) return dsData;
         try {
             m_dataStore = nlohmann::json::parse(dsData.value());
+            m_dataStoreDirty = false;
         } catch(std::exception& e) {
             return Err(std::string("Unable to parse datastore: ") + e.what());
         }
@@ -107,34 +131,35 @@ Result<> Mod::loadSettings() {
 }
 
 Result<> Mod::saveSettings() {
-    // settings
-    auto settPath = m_saveDirPath / "settings.json";
-    auto json = nlohmann::json::object();
-    for (auto& [key, sett] : m_info.m_settings) {
-        if (!sett->save(json[key])) {
-            return Err("Unable to save setting \"" + key + "\"");
+    // only files that changed since they were last saved are
+    // serialized; the writing itself happens in the background
+    // cleared before serializing, so changes made meanwhile are
+    // saved the next time
+    if (m_settingsDirty.exchange(false)) {
+        auto json = nlohmann::json::object();
+        for (auto& [key, sett] : m_info.m_settings) {
+            if (!sett->save(json[key])) {
+                m_settingsDirty = true;
+                return Err("Unable to save setting \"" + key + "\"");
+            }
         }
-    }
-    auto sw = utils::file::writeString(settPath, json.dump(4));
-    if (!sw) {
-        return sw;
+        FileWriter::get().write(m_saveDirPath / "settings.json", json.dump());
     }
 
-    // datastore
-    auto dsPath = m_saveDirPath / "ds.json";
-    auto dw = utils::file::writeString(dsPath, m_dataStore.dump(4));
-    if (!dw) {
-        return dw;
+    if (m_dataStoreDirty.exchange(false)) {
+        FileWriter::get().write(m_saveDirPath / "ds.json", m_dataStore.dump());
     }
 
     return Ok();
 }
 
 DataStore Mod::getDataStore() {
-    return DataStore(this, m_dataStore);
+    return DataStore(this);
 }
 
 void Mod::postDSUpdate() {
+    m_dataStoreDirty = true;
+    InternalLoader::get()->queueModSave(this);
     /*EventCenter::get()->send(Event(
         "datastore-changed",
         this
@@ -143,6 +168,56 @@ void Mod::postDSUpdate() {
 }
 
 Result<> Mod::createTempDir() {
+    auto tempDir = Loader::get()->getGeodeDirectory() / GEODE_TEMP_DIRECTORY;
+    if (!ghc::filesystem::exists(tempDir)) {
+        if (!ghc::filesystem::create_directory(tempDir)) {
+            return Err<>("Unable to create temp directory for mods!");
+        }
+    }
+    
+    auto tempPath = ghc::filesystem::path(tempDir) / m_info.m_id;
+    if (!ghc::filesystem::exists(tempPath) && !ghc::filesystem::create_directories(tempPath)) {
+        return Err<>("Unable to create temp directory");
+    }
+
+    // extracted files are kept between launches, along with a
+    // manifest of the archive they came from and their CRCs
+    auto manifestPath = tempDir / (m_info.m_id + ".manifest.json");
+    auto manifest = nlohmann::json::object();
+    if (ghc::filesystem::exists(manifestPath)) {
+        auto read = utils::file::readString(manifestPath);
+        if (read) {
+            manifest = nlohmann::json::parse(read.value(), nullptr, false);
+        }
+    }
+    auto extracted = manifest.is_object() && manifest.contains("files") && manifest["files"].is_object() ?
+        manifest["files"] :
+        nlohmann::json::object();
+
+    // resources of archives that can be mounted are read out of
+    // the archive, so they don't need to be extracted
+    auto mounted = m_info.m_path.extension() == ".geode" &&
+        ArchiveFS::isHooked() && ArchiveFS::get().mount(m_info.m_path);
+
+    std::error_code ec;
+    auto size = ghc::filesystem::file_size(m_info.m_path, ec);
+    auto modified = ghc::filesystem::last_write_time(m_info.m_path, ec).time_since_epoch().count();
+    auto unchanged = !ec && manifest.is_object() &&
+        manifest.value("size", uintmax_t(0)) == size &&
+        manifest.value("modified", decltype(modified)(0)) == modified &&
+        manifest.value("mounted", false) == mounted &&
+        extracted.contains(m_info.m_binaryName);
+    for (auto& [file, _] : extracted.items()) {
+        if (!unchanged) break;
+        unchanged = ghc::filesystem::exists(tempPath / file);
+    }
+    if (unchanged) {
+        // archive hasn't changed since it was extracted
+        m_tempDirName = tempPath;
+        m_addResourcesToSearchPath = true;
+        return Ok<>(tempPath);
+    }
+
     ZipFile unzip(m_info.m_path.string());
 
     if (!unzip.isLoaded()) {
@@ -156,20 +231,26 @@ Result<> Mod::createTempDir() {
         );
     }
 
-    auto tempDir = Loader::get()->getGeodeDirectory() / GEODE_TEMP_DIRECTORY;
-    if (!ghc::filesystem::exists(tempDir)) {
-        if (!ghc::filesystem::create_directory(tempDir)) {
-            return Err<>("Unable to create temp directory for mods!");
-        }
-    }
-    
-    auto tempPath = ghc::filesystem::path(tempDir) / m_info.m_id;
-    if (!ghc::filesystem::exists(tempPath) && !ghc::filesystem::create_directories(tempPath)) {
-        return Err<>("Unable to create temp directory");
-    }
     m_tempDirName = tempPath;
 
+    auto files = nlohmann::json::object();
     for (auto file : unzip.getAllFiles()) {
+        // resources extracted before it was mounted are deleted
+        // below along with files that aren't in the archive
+        if (mounted && file.starts_with(ArchiveFS::RESOURCES_DIR)) {
+            continue;
+        }
+        auto crc = unzip.getFileCRC(file);
+        files[file] = crc;
+
+        // only files that changed are written again
+        if (
+            extracted.contains(file) && extracted[file] == crc &&
+            ghc::filesystem::exists(tempPath / file)
+        ) {
+            continue;
+        }
+
         auto path = ghc::filesystem::path(file);
         if (path.has_parent_path()) {
             if (
@@ -179,16 +260,35 @@ Result<> Mod::createTempDir() {
                 return Err<>("Unable to create directories \"" + path.parent_path().string() + "\"");
             }
         }
-        unsigned long size;
-        auto data = unzip.getFileData(file, &size);
-        if (!data || !size) {
-            return Err<>("Unable to read \"" + std::string(file) + "\"");
+        ghc::filesystem::ofstream out(tempPath / file, std::ios::out | std::ios::binary);
+        if (!out.is_open()) {
+            return Err<>("Unable to write \"" + file + "\": Unable to open file");
+        }
+        auto read = unzip.readFileChunks(file, [&](unsigned char const* data, unsigned long size) {
+            out.write(reinterpret_cast<char const*>(data), size);
+            return out.good();
+        });
+        if (!read) {
+            return Err<>("Unable to extract \"" + file + "\"");
+        }
+    }
+
+    // files that are no longer in the archive
+    for (auto& [file, _] : extracted.items()) {
+        if (!files.contains(file)) {
+            ghc::filesystem::remove(tempPath / file, ec);
         }
-        auto wrt = utils::file::writeBinary(
-            tempPath / file,
-            byte_array(data, data + size)
-        );
-        if (!wrt) return Err<>("Unable to write \"" + file + "\": " + wrt.error());
+    }
+
+    manifest = {
+        { "size", size },
+        { "modified", modified },
+        { "mounted", mounted },
+        { "files", files },
+    };
+    auto wrt = utils::file::writeString(manifestPath, manifest.dump());
+    if (!wrt) {
+        log::log(Severity::Warning, this, "Unable to save extraction manifest: {}", wrt.error());
     }
 
     m_addResourcesToSearchPath = true;
@@ -205,6 +305,7 @@ Result<> Mod::load() {
         return Err<>(m_loadErrorInfo);}
 
     if (!m_tempDirName.string().size()) {
+        LoadPhase phase("Mod::createTempDir", this);
         auto err = this->createTempDir();
         if (!err) RETURN_LOAD_ERR("Unable to create temp directory: " + err.error());
     }
@@ -212,9 +313,15 @@ Result<> Mod::load() {
     if (this->hasUnresolvedDependencies()) {
         RETURN_LOAD_ERR("Mod has unresolved dependencies");
     }
-    auto err = this->loadPlatformBinary();
-    if (!err) RETURN_LOAD_ERR(err.error());
+    // the binary may have been loaded ahead on another thread
+    if (!m_platformInfo) {
+        LoadPhase phase("Mod::loadPlatformBinary", this);
+        auto err = this->loadPlatformBinary();
+        if (!err) RETURN_LOAD_ERR(err.error());
+    }
+    InternalLoader::get()->releaseScheduleCapture(this);
     if (m_implicitLoadFunc) {
+        LoadPhase phase("geode_implicit_load", this);
         auto r = m_implicitLoadFunc(this);
         if (!r) {
             (void)this->unloadPlatformBinary();
@@ -222,6 +329,7 @@ Result<> Mod::load() {
         }
     }
     if (m_loadFunc) {
+        LoadPhase phase("geode_load", this);
         auto r = m_loadFunc(this);
         if (!r) {
             (void)this->unloadPlatformBinary();
@@ -230,6 +338,7 @@ Result<> Mod::load() {
     }
     m_loaded = true;
     if (m_loadDataFunc) {
+        LoadPhase phase("geode_load_data", this);
         if (!m_loadDataFunc(m_saveDirPath.string().c_str())) {
             log::log(Severity::Error, this, "Mod load data function returned false");
         }
@@ -277,6 +386,8 @@ Result<> Mod::unload() {
     if (!res) {
         return res;
     }
+    // functions exposed to other mods point into the binary
+    Dispatcher::revokeAll(this);
     m_loaded = false;
     Loader::get()->updateAllDependencies();
     return Ok<>();
@@ -345,6 +456,8 @@ Result<> Mod::uninstall() {
             if (!ur) return ur;
         }
     }
+    // can't delete it while it's mapped
+    ArchiveFS::get().unmount(m_info.m_path);
     if (!ghc::filesystem::remove(m_info.m_path)) {
         return Err<>(
             "Unable to delete mod's .geode file! "
@@ -359,6 +472,25 @@ bool Mod::isUninstalled() const {
     return this != InternalMod::get() && !ghc::filesystem::exists(m_info.m_path);
 }
 
+void Mod::setLogLevel(std::optional<Severity> level) {
+    if (level) {
+        m_logLevelOverride = level.value().m_value;
+    } else {
+        m_logLevelOverride = std::nullopt;
+    }
+    m_logLevel.store(
+        m_logLevelOverride.value_or(log::getLogLevel().m_value),
+        std::memory_order_relaxed
+    );
+}
+
+std::optional<Severity> Mod::getLogLevelOverride() const {
+    if (m_logLevelOverride) {
+        return Severity(m_logLevelOverride.value());
+    }
+    return std::nullopt;
+}
+
 bool Dependency::isUnresolved() const {
     return m_required &&
            (m_state == ModResolveState::Unloaded ||
@@ -367,50 +499,29 @@ bool Dependency::isUnresolved() const {
 }
 
 bool Mod::updateDependencyStates() {
+    // doesn't look any further than the direct dependencies;
+    // Loader::updateAllDependencies goes through mods in an
+    // order where those are already settled
     bool hasUnresolved = false;
-	for (auto & dep : m_info.m_dependencies) {
-		if (!dep.m_mod) {
-			dep.m_mod = Loader::get()->getLoadedMod(dep.m_id);
-		}
-		if (dep.m_mod) {
-			dep.m_mod->updateDependencyStates();
-
-			if (dep.m_mod->hasUnresolvedDependencies()) {
-				dep.m_state = ModResolveState::Unresolved;
-			} else {
-				if (!dep.m_mod->m_resolved) {
-					dep.m_mod->m_resolved = true;
-					dep.m_state = ModResolveState::Resolved;
-                    auto r = dep.m_mod->load();
-                    if (!r) {
-                        dep.m_state = ModResolveState::Unloaded;
-                        log::log(Severity::Error, dep.m_mod, "{}", r.error());
-                    }
-                    else {
-                    	auto r = dep.m_mod->enable();
-                    	if (!r) {
-	                        dep.m_state = ModResolveState::Disabled;
-                            log::log(Severity::Error, dep.m_mod, "{}", r.error());
-	                    }
-                    }
-				} else {
-					if (dep.m_mod->isEnabled()) {
-						dep.m_state = ModResolveState::Loaded;
-					} else {
-						dep.m_state = ModResolveState::Disabled;
-					}
-				}
-			}
-		} else {
-			dep.m_state = ModResolveState::Unloaded;
-		}
-		if (dep.isUnresolved()) {
-			m_resolved = false;
-            (void)this->unload();
+    for (auto& dep : m_info.m_dependencies) {
+        dep.m_mod = Loader::get()->getLoadedMod(dep.m_id);
+        if (!dep.m_mod) {
+            dep.m_state = ModResolveState::Unloaded;
+        } else if (dep.m_mod->hasUnresolvedDependencies()) {
+            dep.m_state = ModResolveState::Unresolved;
+        } else if (dep.m_mod->isEnabled()) {
+            dep.m_state = ModResolveState::Loaded;
+        } else {
+            dep.m_state = ModResolveState::Disabled;
+        }
+        if (dep.isUnresolved()) {
             hasUnresolved = true;
-		}
-	}
-    if (!hasUnresolved && !m_resolved) {
+        }
+    }
+    if (hasUnresolved) {
+        m_resolved = false;
+        (void)this->unload();
+    } else if (!m_resolved) {
         log::debug("All dependencies for {} found", m_info.m_id);
         m_resolved = true;
         if (m_enabled) {
@@ -515,6 +626,10 @@ bool Mod::isLoaded() const {
     return m_loaded;
 }
 
+bool Mod::isLoadDeferred() const {
+    return m_deferred;
+}
+
 bool Mod::supportsDisabling() const {
     return m_info.m_supportsDisabling;
 }
@@ -3,6 +3,7 @@
 #include <Geode/loader/Mod.hpp>
 #include <Geode/utils/string.hpp>
 #include <Geode/utils/file.hpp>
+#include <ModInfoCache.hpp>
 
 USE_GEODE_NAMESPACE();
 
@@ -43,6 +44,9 @@ Result<ModInfo> ModInfo::createFromSchemaV010(ModJson const& rawJson) {
     root.has("toggleable").into(info.m_supportsDisabling);
     root.has("unloadable").into(info.m_supportsUnloading);
 
+    std::string load = "startup";
+    root.has("load").into(load);
+
     for (auto& dep : root.has("dependencies").iterate()) {
         auto obj = dep.obj();
 
@@ -128,6 +132,14 @@ Result<ModInfo> ModInfo::createFromSchemaV010(ModJson const& rawJson) {
     }
     root.checkUnknownKeys();
 
+    if (load != "startup" && load != "deferred") {
+        return Err(
+            "[mod.json].load: Invalid value \"" + load + "\", "
+            "expected \"startup\" or \"deferred\""
+        );
+    }
+    info.m_deferLoad = load == "deferred";
+
     return Ok(info);
 }
 
@@ -210,6 +222,25 @@ Result<ModInfo> ModInfo::createFromFile(ghc::filesystem::path const& path) {
 }
 
 Result<ModInfo> ModInfo::createFromGeodeFile(ghc::filesystem::path const& path) {
+    // archives that haven't changed since they were last read
+    // don't need to be opened
+    if (auto cached = ModInfoCache::get().find(path)) {
+        auto res = ModInfo::create(cached->m_json);
+        if (!res) {
+            return Err("\"" + path.string() + "\" - " + res.error());
+        }
+        auto info = res.value();
+        info.m_path = path;
+        for (auto& [file, target] : info.getSpecialFiles()) {
+            for (auto& [name, data] : cached->m_files) {
+                if (name == file) {
+                    *target = data;
+                }
+            }
+        }
+        return Ok(info);
+    }
+
     ZipFile unzip(path.string());
     if (!unzip.isLoaded()) {
         return Err<>("\"" + path.string() + "\": Unable to unzip");
@@ -252,6 +283,14 @@ Result<ModInfo> ModInfo::createFromGeodeFile(ghc::filesystem::path const& path)
     if (!err) {
         return Err(err.error());
     }
+
+    std::vector<std::pair<std::string, std::string>> files;
+    for (auto& [file, target] : info.getSpecialFiles()) {
+        if (*target) {
+            files.push_back({ file, target->value() });
+        }
+    }
+    ModInfoCache::get().store(path, json, files);
     
     return Ok(info);
 }
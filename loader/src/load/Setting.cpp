@@ -3,6 +3,7 @@
 #include <Geode/utils/general.hpp>
 #include <Geode/loader/SettingNode.hpp>
 #include "../ui/internal/settings/GeodeSettingNode.hpp"
+#include <InternalLoader.hpp>
 
 USE_GEODE_NAMESPACE();
 
@@ -56,6 +57,7 @@ Result<std::shared_ptr<Setting>> Setting::parse(
 }
 
 void Setting::valueChanged() {
+    InternalLoader::get()->settingsChanged(m_modID);
     SettingChangedEvent(m_modID, shared_from_this()).post();
 }
 
@@ -0,0 +1,476 @@
+#include <Geode/loader/Trace.hpp>
+#include <Geode/loader/Mod.hpp>
+#include <Geode/utils/file.hpp>
+#include <Geode/utils/ranges.hpp>
+#include <fmt/format.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#if !defined(GEODE_IS_WINDOWS)
+#include <cxxabi.h>
+#endif
+
+USE_GEODE_NAMESPACE();
+using namespace geode::trace;
+
+namespace {
+    /**
+     * Ring buffer owned by one thread. Only the owning thread
+     * writes; other threads read it through a per-slot sequence
+     * lock, skipping records that are being overwritten
+     */
+    struct ThreadBuffer {
+        static constexpr size_t CAPACITY = 1 << 14;
+        static constexpr size_t WORDS = (sizeof(Record) + 7) / 8;
+
+        static_assert(std::is_trivially_copyable_v<Record>);
+
+        /**
+         * A record stored as atomic words so reading it while it's
+         * being written isn't a data race. m_sequence is odd while
+         * the record is being written, and otherwise twice the
+         * record's index plus two
+         */
+        struct Slot {
+            std::atomic<uint64_t> m_sequence = 0;
+            std::atomic<uint64_t> m_words[WORDS];
+        };
+
+        size_t m_threadIndex;
+        std::unique_ptr<Slot[]> m_slots = std::make_unique<Slot[]>(CAPACITY);
+        std::atomic<uint64_t> m_written = 0;
+        /**
+         * Records before this index were dropped by trace::clear
+         */
+        std::atomic<uint64_t> m_cleared = 0;
+
+        ThreadBuffer(size_t index) : m_threadIndex(index) {}
+
+        void push(Record const& record) {
+            auto index = m_written.load(std::memory_order_relaxed);
+            auto& slot = m_slots[index % CAPACITY];
+            uint64_t words[WORDS] = {};
+            std::memcpy(words, &record, sizeof(Record));
+
+            slot.m_sequence.store(index * 2 + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < WORDS; i++) {
+                slot.m_words[i].store(words[i], std::memory_order_relaxed);
+            }
+            slot.m_sequence.store(index * 2 + 2, std::memory_order_release);
+            m_written.store(index + 1, std::memory_order_release);
+        }
+
+        /**
+         * Read the record at an index
+         * @returns False if it has been or is being overwritten
+         */
+        bool read(uint64_t index, Record& into) const {
+            auto& slot = m_slots[index % CAPACITY];
+            auto sequence = slot.m_sequence.load(std::memory_order_acquire);
+            if (sequence != index * 2 + 2) {
+                return false;
+            }
+            uint64_t words[WORDS];
+            for (size_t i = 0; i < WORDS; i++) {
+                words[i] = slot.m_words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.m_sequence.load(std::memory_order_relaxed) != sequence) {
+                return false;
+            }
+            std::memcpy(&into, words, sizeof(Record));
+            return true;
+        }
+
+        uint64_t getFirst(uint64_t end) const {
+            auto first = end > CAPACITY ? end - CAPACITY : 0;
+            return std::max(first, m_cleared.load(std::memory_order_relaxed));
+        }
+
+        /**
+         * Collect records overlapping a time range. Only called on
+         * the owning thread, so no record can be overwritten
+         */
+        void collectRange(uint64_t from, uint64_t to, std::vector<Record>& into) const {
+            auto end = m_written.load(std::memory_order_relaxed);
+            auto begin = this->getFirst(end);
+            // records are pushed when they finish, so walking
+            // back can stop at the first one that ended too early
+            Record rec;
+            for (auto i = end; i > begin; i--) {
+                if (!this->read(i - 1, rec)) continue;
+                if (rec.m_start + rec.m_duration < from) break;
+                if (rec.m_start <= to) {
+                    into.push_back(rec);
+                }
+            }
+        }
+
+        void collect(std::vector<Record>& into) const {
+            auto end = m_written.load(std::memory_order_acquire);
+            Record rec;
+            for (auto i = this->getFirst(end); i < end; i++) {
+                // records the writer has lapped in the meantime
+                // are skipped
+                if (this->read(i, rec)) {
+                    into.push_back(rec);
+                }
+            }
+        }
+    };
+
+    /**
+     * Strings records point to. Names, categories and details may
+     * live in a mod's binary, and mod IDs in the mod, so each is
+     * copied once and never freed; records can then point to them
+     * for the rest of the session. Each thread caches the copy made
+     * for each address, and forgetMod bumps the generation to empty
+     * the caches since an unloaded mod's addresses may be reused
+     */
+    struct Strings {
+        std::mutex m_mutex;
+        std::unordered_set<std::string> m_strings;
+        std::atomic<size_t> m_generation = 0;
+
+        struct Cache {
+            std::unordered_map<const char*, const char*> m_strings;
+            std::unordered_map<Mod*, const char*> m_modIDs;
+            size_t m_generation = 0;
+        };
+
+        static Strings& get() {
+            static auto inst = new Strings;
+            return *inst;
+        }
+
+        Cache& getCache() {
+            static thread_local Cache cache;
+            auto generation = m_generation.load(std::memory_order_acquire);
+            if (generation != cache.m_generation) {
+                cache.m_strings.clear();
+                cache.m_modIDs.clear();
+                cache.m_generation = generation;
+            }
+            return cache;
+        }
+
+        const char* copy(std::string str) {
+            std::lock_guard lock(m_mutex);
+            return m_strings.insert(std::move(str)).first->c_str();
+        }
+
+        const char* intern(const char* str) {
+            if (!str) return nullptr;
+            auto& cache = this->getCache().m_strings;
+            auto it = cache.find(str);
+            if (it != cache.end()) {
+                return it->second;
+            }
+            auto res = this->copy(str);
+            cache.insert({ str, res });
+            return res;
+        }
+
+        const char* internModID(Mod* mod) {
+            if (!mod) return nullptr;
+            auto& cache = this->getCache().m_modIDs;
+            auto it = cache.find(mod);
+            if (it != cache.end()) {
+                return it->second;
+            }
+            auto res = this->copy(mod->getID());
+            cache.insert({ mod, res });
+            return res;
+        }
+    };
+
+    struct TraceState {
+        std::atomic<bool> m_enabled = false;
+        std::atomic<bool> m_capturing = false;
+        std::atomic<bool> m_background = false;
+        std::chrono::steady_clock::time_point m_epoch = std::chrono::steady_clock::now();
+        std::mutex m_buffersMutex;
+        // buffers outlive their threads so their records can
+        // still be exported, until they're reused or cleared
+        std::vector<ThreadBuffer*> m_buffers;
+        // buffers of threads that have exited
+        std::vector<ThreadBuffer*> m_free;
+        size_t m_nextThreadIndex = 0;
+
+        /**
+         * Hands the calling thread's buffer back when it exits
+         */
+        struct Owner {
+            ThreadBuffer* m_buffer = nullptr;
+
+            ~Owner() {
+                if (m_buffer) {
+                    auto& state = TraceState::get();
+                    std::lock_guard lock(state.m_buffersMutex);
+                    state.m_free.push_back(m_buffer);
+                }
+            }
+        };
+
+        static TraceState& get() {
+            static auto inst = new TraceState;
+            return *inst;
+        }
+
+        static Owner& getOwner() {
+            static thread_local Owner owner;
+            return owner;
+        }
+
+        /**
+         * Get the calling thread's buffer. Threads only get one
+         * while a capture is running, or when they ask for their
+         * own records like the hitch monitor does, so background
+         * tracing doesn't cost every thread a buffer
+         * @param create Whether to make one if there is none
+         */
+        ThreadBuffer* getThreadBuffer(bool create) {
+            auto& owner = getOwner();
+            if (owner.m_buffer || !create) {
+                return owner.m_buffer;
+            }
+            std::lock_guard lock(m_buffersMutex);
+            // reusing a buffer drops the records of the thread that
+            // had it, so that waits until nobody is capturing them
+            if (m_free.size() && !m_capturing.load(std::memory_order_relaxed)) {
+                owner.m_buffer = m_free.back();
+                m_free.pop_back();
+                owner.m_buffer->m_cleared.store(
+                    owner.m_buffer->m_written.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed
+                );
+            } else {
+                owner.m_buffer = new ThreadBuffer(m_nextThreadIndex++);
+                m_buffers.push_back(owner.m_buffer);
+            }
+            return owner.m_buffer;
+        }
+
+        void updateEnabled() {
+            m_enabled.store(
+                m_capturing.load(std::memory_order_relaxed) ||
+                    m_background.load(std::memory_order_relaxed),
+                std::memory_order_relaxed
+            );
+        }
+    };
+
+    std::string demangle(const char* name) {
+    #if defined(GEODE_IS_WINDOWS)
+        return name;
+    #else
+        int status = 0;
+        auto res = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+        if (status == 0 && res) {
+            std::string str = res;
+            free(res);
+            return str;
+        }
+        return name;
+    #endif
+    }
+
+    std::string readable(Record const& rec, const char* name) {
+        // event records are named after types from typeid;
+        // anything else may be a string that happens to
+        // look like a mangled name
+        auto typeNames = rec.m_category && std::string_view(rec.m_category).starts_with("event");
+        return typeNames ? demangle(name) : std::string(name);
+    }
+
+    std::string escape(std::string const& str) {
+        std::string res;
+        res.reserve(str.size());
+        for (auto c : str) {
+            switch (c) {
+                case '"':  res += "\\\""; break;
+                case '\\': res += "\\\\"; break;
+                case '\n': res += "\\n"; break;
+                case '\t': res += "\\t"; break;
+                default: {
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        res += fmt::format("\\u{:04x}", c);
+                    } else {
+                        res += c;
+                    }
+                } break;
+            }
+        }
+        return res;
+    }
+}
+
+std::atomic<bool> const& trace::getEnabledFlag() {
+    return TraceState::get().m_enabled;
+}
+
+void trace::setEnabled(bool enabled) {
+    auto& state = TraceState::get();
+    state.m_capturing.store(enabled, std::memory_order_relaxed);
+    state.updateEnabled();
+}
+
+bool trace::isCapturing() {
+    return TraceState::get().m_capturing.load(std::memory_order_relaxed);
+}
+
+void trace::setBackground(bool background) {
+    auto& state = TraceState::get();
+    state.m_background.store(background, std::memory_order_relaxed);
+    state.updateEnabled();
+}
+
+uint64_t trace::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - TraceState::get().m_epoch
+    ).count();
+}
+
+void trace::record(Record const& record) {
+    auto& state = TraceState::get();
+    auto buffer = state.getThreadBuffer(state.m_capturing.load(std::memory_order_relaxed));
+    if (!buffer) return;
+
+    auto& strings = Strings::get();
+    auto copy = record;
+    copy.m_name = strings.intern(record.m_name);
+    copy.m_category = strings.intern(record.m_category);
+    copy.m_detail = strings.intern(record.m_detail);
+    if (record.m_mod) {
+        copy.m_modID = strings.internModID(record.m_mod);
+        copy.m_mod = nullptr;
+    }
+    buffer->push(copy);
+}
+
+void trace::forgetMod(Mod*) {
+    Strings::get().m_generation.fetch_add(1, std::memory_order_release);
+}
+
+std::vector<Record> trace::getThreadRecords(uint64_t from, uint64_t to) {
+    std::vector<Record> res;
+    TraceState::get().getThreadBuffer(true)->collectRange(from, to, res);
+    return res;
+}
+
+std::string trace::getName(Record const& record) {
+    return readable(record, record.m_name ? record.m_name : "?");
+}
+
+void trace::clear() {
+    auto& state = TraceState::get();
+    std::lock_guard lock(state.m_buffersMutex);
+    // nothing's left in the buffers of threads that have exited,
+    // and no thread is writing to them
+    for (auto buffer : state.m_free) {
+        ranges::remove(state.m_buffers, buffer);
+        delete buffer;
+    }
+    state.m_free.clear();
+    for (auto& buffer : state.m_buffers) {
+        buffer->m_cleared.store(
+            buffer->m_written.load(std::memory_order_acquire), std::memory_order_relaxed
+        );
+    }
+}
+
+namespace {
+    void appendRecord(std::string& res, Record const& rec, size_t threadIndex) {
+        res += fmt::format(
+            "{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"{}\",\"ts\":{:.3f},"
+            "\"pid\":0,\"tid\":{}",
+            escape(getName(rec)),
+            escape(rec.m_category ? rec.m_category : ""),
+            static_cast<char>(rec.m_phase),
+            rec.m_start / 1000.0,
+            threadIndex
+        );
+        switch (rec.m_phase) {
+            case Phase::Complete: {
+                res += fmt::format(",\"dur\":{:.3f}", rec.m_duration / 1000.0);
+            } break;
+
+            case Phase::Instant: {
+                res += ",\"s\":\"t\"";
+            } break;
+
+            case Phase::Counter: {
+                // a counter's args are the values it graphs
+                res += fmt::format(",\"args\":{{\"value\":{}}}}}", rec.m_value);
+                return;
+            }
+
+            case Phase::AsyncBegin:
+            case Phase::AsyncEnd: {
+                res += fmt::format(",\"id\":\"0x{:x}\"", rec.m_id);
+            } break;
+        }
+        res += ",\"args\":{";
+        bool firstArg = true;
+        auto addArg = [&](std::string const& key, std::string const& value) {
+            if (!firstArg) res += ",";
+            firstArg = false;
+            res += "\"" + key + "\":" + value;
+        };
+        if (rec.m_modID) {
+            addArg("mod", "\"" + escape(rec.m_modID) + "\"");
+        }
+        if (rec.m_detail) {
+            addArg("detail", "\"" + escape(readable(rec, rec.m_detail)) + "\"");
+        }
+        if (rec.m_stopped) {
+            addArg("stopped", "true");
+        }
+        res += "}}";
+    }
+}
+
+std::string trace::exportChromeTrace() {
+    auto& state = TraceState::get();
+    std::string res = "{\"traceEvents\":[";
+    bool first = true;
+
+    std::lock_guard lock(state.m_buffersMutex);
+    std::vector<Record> records;
+    for (auto& buffer : state.m_buffers) {
+        records.clear();
+        buffer->collect(records);
+        for (auto& rec : records) {
+            if (!first) res += ",";
+            first = false;
+            appendRecord(res, rec, buffer->m_threadIndex);
+        }
+    }
+    res += "],\"displayTimeUnit\":\"ms\"}";
+    return res;
+}
+
+std::string trace::exportChromeTrace(std::vector<Record> const& records) {
+    std::string res = "{\"traceEvents\":[";
+    bool first = true;
+    for (auto& rec : records) {
+        if (!first) res += ",";
+        first = false;
+        appendRecord(res, rec, 0);
+    }
+    res += "],\"displayTimeUnit\":\"ms\"}";
+    return res;
+}
+
+Result<> trace::saveChromeTrace(ghc::filesystem::path const& path) {
+    return utils::file::writeString(path, exportChromeTrace());
+}
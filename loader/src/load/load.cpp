@@ -1,6 +1,8 @@
 #include <Geode/DefaultInclude.hpp>
 #include <Geode/loader/Loader.hpp>
 #include <Geode/loader/Mod.hpp>
+#include <Geode/loader/Trace.hpp>
+#include <LoadProfiler.hpp>
 #undef snprintf
 
 USE_GEODE_NAMESPACE();
@@ -24,19 +26,34 @@ bool Mod::validateID(std::string const& id) {
 
 Result<Mod*> Loader::loadModFromFile(std::string const& path) {
     // load mod.json
+    auto parseStart = trace::now();
     auto res = ModInfo::createFromGeodeFile(path);
+    auto parseTime = trace::now() - parseStart;
     if (!res) {
         return Err(res.error());
     }
+    auto mod = this->loadModFromInfo(res.value());
+    if (mod) {
+        LoadProfiler::get().add("ModInfo::createFromGeodeFile", mod.value(), parseStart, parseTime);
+        this->updateAllDependencies();
+    }
+    return mod;
+}
 
+Result<Mod*> Loader::loadModFromInfo(ModInfo const& info) {
     // check that a duplicate has not been loaded
-    if (m_mods.count(res.value().m_id)) {
-        return Err("Mod with ID \"" + res.value().m_id + "\" has already been loaded!");
+    if (m_mods.count(info.m_id)) {
+        return Err("Mod with ID \"" + info.m_id + "\" has already been loaded!");
     }
     
     // create and set up Mod instance
-    auto mod = new Mod(res.value());
-    mod->m_saveDirPath = Loader::get()->getGeodeSaveDirectory() / GEODE_MOD_DIRECTORY / res.value().m_id;
+    auto mod = new Mod(info);
+    if (m_loadedSettings.m_mods.count(mod->m_info.m_id)) {
+        if (auto level = m_loadedSettings.m_mods.at(mod->m_info.m_id).m_logLevel) {
+            mod->setLogLevel(level.value());
+        }
+    }
+    mod->m_saveDirPath = Loader::get()->getGeodeSaveDirectory() / GEODE_MOD_DIRECTORY / info.m_id;
     ghc::filesystem::create_directories(mod->m_saveDirPath);
 
     auto sett = mod->loadSettings();
@@ -46,8 +63,7 @@ Result<Mod*> Loader::loadModFromFile(std::string const& path) {
 
     // enable mod if needed
     mod->m_enabled = Loader::get()->shouldLoadMod(mod->m_info.m_id);
-    m_mods.insert({ res.value().m_id, mod });
-    mod->updateDependencyStates();
+    m_mods.insert({ info.m_id, mod });
 
     // add mod resources
     this->queueInGDThread([this, mod]() {
@@ -104,6 +104,7 @@ Result<> Mod::loadPlatformBinary() {
 Result<> Mod::unloadPlatformBinary() {
     auto hmod = this->m_platformInfo->m_hmod;
     delete this->m_platformInfo;
+    this->m_platformInfo = nullptr;
     if (FreeLibrary(hmod)) {
         this->m_implicitLoadFunc = nullptr;
         this->m_unloadFunc = nullptr;
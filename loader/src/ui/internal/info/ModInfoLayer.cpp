@@ -9,6 +9,8 @@
 #include <Geode/ui/MDPopup.hpp>
 #include "../settings/ModSettingsPopup.hpp"
 #include <InternalLoader.hpp>
+#include <LoadProfiler.hpp>
+#include <FrameMonitor.hpp>
 #include <Geode/binding/Slider.hpp>
 #include <Geode/binding/SliderThumb.hpp>
 #include <Geode/binding/ButtonSprite.hpp>
@@ -16,6 +18,8 @@
 #include <Geode/binding/GJListLayer.hpp>
 #include <Geode/binding/CCTextInputNode.hpp>
 #include <Geode/loader/Mod.hpp>
+#include <Geode/loader/Trace.hpp>
+#include <fmt/chrono.h>
 
 // TODO: die
 #undef min
@@ -24,6 +28,36 @@
 static constexpr const int TAG_CONFIRM_UNINSTALL = 5;
 static constexpr const int TAG_DELETE_SAVEDATA = 6;
 
+/**
+ * Load time section for the details page. Geode's own page lists
+ * the slowest mods and recent frame hitches instead
+ */
+static std::string loadTimeDetails(Mod* mod) {
+    auto& profiler = LoadProfiler::get();
+    if (mod == Loader::get()->getInternalMod()) {
+        std::string res;
+        auto slowest = profiler.getSlowestMods(5);
+        if (slowest.size()) {
+            res += "\n\n### Slowest mods to load\n";
+        }
+        for (auto& [slow, time] : slowest) {
+            res += fmt::format("\n* **{}**: {:.1f} ms", slow->getName(), time / 1'000'000.0);
+        }
+        auto& hitches = FrameMonitor::get().getHitches();
+        if (hitches.size()) {
+            res += "\n\n### Recent hitches\n";
+        }
+        // newest first
+        for (auto it = hitches.rbegin(); it != hitches.rend(); it++) {
+            res += fmt::format("\n* {:%H:%M:%S} {}", it->m_time, it->toString());
+        }
+        return res;
+    }
+    auto time = profiler.getModLoadTime(mod);
+    if (!time) return "";
+    return fmt::format("\n\n### Load time\n\nLoaded in {:.1f} ms", time / 1'000'000.0);
+}
+
 bool DownloadStatusNode::init() {
     if (!CCNode::init())
         return false;
@@ -189,12 +223,13 @@ bool ModInfoLayer::init(ModObject* obj, ModListView* list) {
     CCDirector::sharedDirector()->getTouchDispatcher()->incrementForcePrio(2);
     this->registerWithTouchDispatcher();
 
-    m_detailsArea = MDTextArea::create(
-        m_info.m_details ?
-            m_info.m_details.value() :
-            "### No description provided.",
-        { 350.f, 137.5f }
-    );
+    auto details = m_info.m_details ?
+        m_info.m_details.value() :
+        "### No description provided.";
+    if (isInstalledMod) {
+        details += loadTimeDetails(m_mod);
+    }
+    m_detailsArea = MDTextArea::create(details, { 350.f, 137.5f });
     m_detailsArea->setPosition(
         winSize.width / 2 - m_detailsArea->getScaledContentSize().width / 2,
         winSize.height / 2 - m_detailsArea->getScaledContentSize().height / 2 - 20.f
@@ -361,6 +396,27 @@ bool ModInfoLayer::init(ModObject* obj, ModListView* list) {
             disableBtnSpr->setColor({ 150, 150, 150 });
         }
 
+        // tracing is started and saved from Geode's own page
+        if (m_mod == Loader::get()->getInternalMod()) {
+            auto traceBtnSpr = ButtonSprite::create(
+                "Trace", "bigFont.fnt", "GJ_button_01.png", .6f
+            );
+            traceBtnSpr->setScale(.6f);
+
+            auto saveTraceBtnSpr = ButtonSprite::create(
+                "Save Trace", "bigFont.fnt", "GJ_button_02.png", .6f
+            );
+            saveTraceBtnSpr->setScale(.6f);
+
+            auto traceBtn = CCMenuItemToggler::create(
+                traceBtnSpr, saveTraceBtnSpr,
+                this, menu_selector(ModInfoLayer::onTrace)
+            );
+            traceBtn->setPosition(-75.f, 75.f);
+            traceBtn->toggle(trace::isCapturing());
+            m_buttonMenu->addChild(traceBtn);
+        }
+
         if (
             m_mod != Loader::get()->getInternalMod() &&
             m_mod != Mod::get()
@@ -726,6 +782,30 @@ void ModInfoLayer::onHooks(CCObject*) {
     layer->showLayer(false);
 }
 
+void ModInfoLayer::onTrace(CCObject* pSender) {
+    if (!trace::isCapturing()) {
+        trace::clear();
+        trace::setEnabled(true);
+    } else {
+        trace::setEnabled(false);
+        auto path = Loader::get()->getGeodeDirectory() / GEODE_LOG_DIRECTORY /
+            fmt::format("Trace {:%d %b %H.%M.%S}.json", log::log_clock::now());
+        auto res = trace::saveChromeTrace(path);
+        if (res) {
+            FLAlertLayer::create(
+                "Trace Saved",
+                "Saved to <cy>" + path.string() + "</c>. Open it in "
+                "<cb>chrome://tracing</c> or <cb>Perfetto</c>.",
+                "OK"
+            )->show();
+        } else {
+            FLAlertLayer::create("Error", "Unable to save trace: " + res.error(), "OK")->show();
+        }
+    }
+    // the toggler flips itself after this
+    as<CCMenuItemToggler*>(pSender)->toggle(!trace::isCapturing());
+}
+
 void ModInfoLayer::onSettings(CCObject*) {
     ModSettingsPopup::create(m_mod)->show();
 }
@@ -45,6 +45,7 @@ protected:
     Scrollbar* m_scrollbar;
 
     void onHooks(CCObject*);
+    void onTrace(CCObject*);
     void onSettings(CCObject*);
     void onNoSettings(CCObject*);
     void onInfo(CCObject*);
@@ -205,12 +205,14 @@ SentAsyncWebRequest::SentAsyncWebRequest(
                     }
                     return 1;
                 }
+                // curl calls this very often, and only the latest
+                // progress is worth showing
                 Loader::get()->queueInGDThread([self = data->self, now, total]() {
                     std::lock_guard _(self->m_mutex);
                     for (auto& prog : self->m_progresses) {
                         prog(*self, now, total);
                     }
-                });
+                }, data->self);
                 return 0;
             }
         );
@@ -67,8 +67,8 @@ class $modify(GJGarageLayerTest, GJGarageLayer) {
 	    addChild(label2);
 
 	    // Dispatch system pt. 1
-	    // auto fn = Dispatcher::get()->getFunction<void(GJGarageLayer*)>("test-garage-open");
-	    // fn(this);
+	    static DispatchFn<void(GJGarageLayer*)> fn("test-garage-open");
+	    fn(this);
 
 	    return true;
 	}